@@ -0,0 +1,47 @@
+#version 430 core
+
+// Keeps the nearest primitive along the ray through the fragment, with
+// the same tests as hitSphere() and hitPrimitive() in raytrace.comp.
+
+in vec3 worldPosition;
+flat in vec4 sphere;
+flat in vec3 quadNormal;
+flat in int primRef;
+
+uniform vec3 cameraPosition;
+
+layout(location = 0) out int outRef;
+
+void main() {
+    const vec3 direction = normalize(worldPosition - cameraPosition);
+    float t;
+    if (sphere.w > 0.0) {
+        const vec3 dir = sphere.xyz - cameraPosition;
+        const float b = -2.0 * dot(direction, dir);
+        const float c = dot(dir, dir) - sphere.w * sphere.w;
+        const float discriminant = b * b - 4.0 * c;
+        if (discriminant < 0.0) {
+            discard;
+        }
+        const float sqrtd = sqrt(discriminant);
+        t = (-b - sqrtd) * 0.5;
+        if (!(t > 1e-3)) {
+            t = (-b + sqrtd) * 0.5;
+            if (!(t > 0.0)) {
+                discard;
+            }
+        }
+    }
+    else {
+        // Quads are one-sided.
+        if (dot(direction, quadNormal) > 0.0) {
+            discard;
+        }
+        t = length(worldPosition - cameraPosition);
+    }
+
+    // Nearer is larger, and float keeps the same relative precision at
+    // every distance; the depth test is GL_GREATER.
+    gl_FragDepth = 1.0 / (1.0 + t);
+    outRef = primRef;
+}
@@ -0,0 +1,63 @@
+#version 430 core
+
+// Primary visibility raster, see PrimaryRaster.h. Quads arrive as their
+// corners, spheres as four corners of a camera-facing impostor around
+// their silhouette.
+
+// xyz: a quad corner or the sphere's centre; w: the sphere's radius, 0
+// for quads.
+layout(location = 0) in vec4 aPosition;
+// Quads: cross(u, v). Spheres: the impostor corner in xy.
+layout(location = 1) in vec3 aAxis;
+// World::PrimitiveType reference, (index << 1) | type.
+layout(location = 2) in float aRef;
+
+uniform vec3 cameraPosition;
+uniform vec3 cameraForward;
+uniform vec3 cameraRight;
+uniform vec3 cameraUp;
+// Maps the viewport plane at distance 1 to normalized device coordinates
+// so pixel centres land on the frame's jittered sample point.
+uniform vec2 viewportScale;
+uniform vec2 viewportOffset;
+
+out vec3 worldPosition;
+flat out vec4 sphere;
+flat out vec3 quadNormal;
+flat out int primRef;
+
+const float NEAR = 1e-3;
+
+void main() {
+    primRef = int(aRef + 0.5);
+    sphere = aPosition;
+    quadNormal = aAxis;
+
+    vec3 world = aPosition.xyz;
+    if (aPosition.w > 0.0) {
+        const vec3 toCenter = world - cameraPosition;
+        const float d = length(toCenter);
+        const float r = aPosition.w;
+        // From inside, the sphere covers the whole screen.
+        if (d <= r * 1.0001) {
+            gl_Position = vec4(aAxis.xy, 0.0, 1.0);
+            const vec2 view = (aAxis.xy - viewportOffset) / viewportScale;
+            worldPosition = cameraPosition + cameraForward + view.x * cameraRight + view.y * cameraUp;
+            return;
+        }
+        const vec3 n = toCenter / d;
+        const vec3 right = normalize(cross(n, abs(n.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+        const vec3 up = cross(right, n);
+        // Radius of the silhouette cone where it crosses the plane through
+        // the centre.
+        const float s = r * d / sqrt(d * d - r * r);
+        world += (aAxis.x * right + aAxis.y * up) * s;
+    }
+
+    const vec3 v = world - cameraPosition;
+    const vec3 view = vec3(dot(v, cameraRight), dot(v, cameraUp), dot(v, cameraForward));
+    // Clipped at NEAR and never at the far end; the fragment shader writes
+    // the depth.
+    gl_Position = vec4(view.xy * viewportScale + viewportOffset * view.z, view.z - 2.0 * NEAR, view.z);
+    worldPosition = world;
+}
@@ -5,12 +5,25 @@ layout(location = 0) out vec4 fragColor;
 in vec2 texCoord;
 
 
-uniform vec2 resolution;
-uniform sampler2D tex;
-
-uniform int toneMappingMethodIdx;
-uniform float exposure;
-uniform float gamma;
+layout(binding = 0) uniform sampler2D tex;
+// raytrace.comp's sampleStats, frames per pixel in x.
+layout(binding = 1) uniform sampler2D sampleStats;
+
+// The leading part of the Frame block in raytrace.comp; the camera is
+// skipped over and the tile list left out.
+layout(std140, binding = 0) uniform Frame {
+    vec4 camera[5];
+    vec3 skyColor;
+    int countRays;
+    vec2 resolution;
+    int toneMappingMethodIdx;
+    float exposure;
+    float gamma;
+    float adaptiveThreshold;
+    int adaptiveMinSamples;
+    // 0, or the frame count drawn hottest in the sample heatmap.
+    int sampleHeatmap;
+};
 
 #define AGX_LOOK 0
 
@@ -334,7 +347,19 @@ vec3 lms_to_rgb(vec3 c)
 	return c * m;
 }
 
+// Blue through green to red as t goes from 0 to 1.
+vec3 heatmap(float t) {
+    t = clamp(t, 0.0, 1.0);
+    return clamp(vec3(2.0 * t - 1.0, 1.0 - abs(2.0 * t - 1.0), 1.0 - 2.0 * t), 0.0, 1.0);
+}
+
 void main() {
+    if (sampleHeatmap > 0) {
+        float frames = texture(sampleStats, texCoord).x;
+        fragColor = vec4(heatmap(frames / float(sampleHeatmap)), 1);
+        return;
+    }
+
     vec3 color = texture(tex, texCoord).rgb;
 
     if (any(isnan(color)) || any(isinf(color)) || any(lessThan(color, vec3(0.0)))) {
@@ -0,0 +1,55 @@
+#include "AllocCounter.h"
+
+#ifdef ALLOC_COUNTER
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<u64> s_allocations(0);
+
+void* operator new(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+u64 heapAllocationCount() {
+    return s_allocations.load(std::memory_order_relaxed);
+}
+#else
+u64 heapAllocationCount() {
+    return 0;
+}
+#endif
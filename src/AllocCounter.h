@@ -0,0 +1,16 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include "util.h"
+
+// Debug builds (no NDEBUG) replace the global operator new to count heap
+// allocations, so loops that are meant not to allocate can be checked.
+// Other builds leave operator new alone and always report 0.
+#ifndef NDEBUG
+#define ALLOC_COUNTER 1
+#endif
+
+// Allocations made through operator new so far, from any thread.
+u64 heapAllocationCount();
+
+#endif
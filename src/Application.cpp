@@ -6,14 +6,27 @@
 #include "imgui/imgui_impl_opengl3.h"
 #include "glm/gtc/type_ptr.hpp"
 #include <cstring>
+#include <algorithm>
 #include <string>
 #include <unordered_map>
-#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 
 #include "OpenGL/ComputeShader.h"
 #include "OpenGL/Image2D.h"
+#include "CPU/Denoiser.h"
+#include "OpenGL/FrameBufferObject.h"
+#include "Scenes.h"
+#include "ImageWriter.h"
+#include "Benchmark.h"
+#include "AllocCounter.h"
 
 #define SHADER_SOURCE_DIRECTORY "shaders/"
+#define RAY_COUNTER_BINDING 18
+#define TILE_SIZE 128
+#define PRIMARY_REFS_UNIT 0
 
 static f32 vertices[] = {
      1.0,  1.0, 1, 1,
@@ -31,7 +44,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     Application::Detail& det = static_cast<Application*>(glfwGetWindowUserPointer(window))->detail;
     det.resolution.x = width;
     det.resolution.y = height;
-    glViewport(0, 0, width, height);
+    GLCALL(glViewport(0, 0, width, height));
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -55,7 +68,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     (void)xoffset;
     Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
     app->world->cam.fov -= yoffset;
-    app->detail.frameIndex = 1;
+    app->detail.cameraMoved = true;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
@@ -74,7 +87,6 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
         last_pos.y = ypos;
         first_mouse = false;
     }
-    app->detail.frameIndex = 1;
 
     float xoffset = xpos - last_pos.x;
     float yoffset = last_pos.y - ypos; 
@@ -82,38 +94,60 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     last_pos.y = ypos;
 
     float sensitivity = 0.04f;
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
+    app->turnCamera(xoffset * sensitivity, yoffset * sensitivity);
+}
 
-    app->world->cam.yaw   += xoffset;
-    app->world->cam.pitch += yoffset;
+void Application::turnCamera(float yaw, float pitch) {
+    detail.cameraMoved = true;
+    world->cam.yaw   += yaw;
+    world->cam.pitch += pitch;
 
-    if(app->world->cam.pitch > 89.0f)
-        app->world->cam.pitch = 89.0f;
-    if(app->world->cam.pitch < -89.0f)
-        app->world->cam.pitch = -89.0f;
+    if(world->cam.pitch > 89.0f)
+        world->cam.pitch = 89.0f;
+    if(world->cam.pitch < -89.0f)
+        world->cam.pitch = -89.0f;
 
     glm::vec3 direction;
-    direction.x = cos(glm::radians(180 + app->world->cam.yaw)) * cos(glm::radians(app->world->cam.pitch));
-    direction.y = sin(glm::radians(app->world->cam.pitch));
-    direction.z = sin(glm::radians(app->world->cam.yaw)) * cos(glm::radians(app->world->cam.pitch));
-    app->world->cam.forward = glm::normalize(direction);
-    app->world->cam.right = normalize(-glm::cross(app->world->cam.forward, glm::vec3(0, 1, 0)));
-    app->world->cam.up = glm::cross(-app->world->cam.right, app->world->cam.forward);
+    direction.x = cos(glm::radians(180 + world->cam.yaw)) * cos(glm::radians(world->cam.pitch));
+    direction.y = sin(glm::radians(world->cam.pitch));
+    direction.z = sin(glm::radians(world->cam.yaw)) * cos(glm::radians(world->cam.pitch));
+    world->cam.forward = glm::normalize(direction);
+    world->cam.right = normalize(-glm::cross(world->cam.forward, glm::vec3(0, 1, 0)));
+    world->cam.up = glm::cross(-world->cam.right, world->cam.forward);
 }
 
-Application::Application() {
-    glfwInit();
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    detail.resolution = glm::ivec2(1920, 1280);
-    m_window = glfwCreateWindow(detail.resolution.x, detail.resolution.y, "glsl test", NULL, NULL);
+Application::Application(const Options& options)
+    : m_window(nullptr), m_options(options), m_frameBatches(0), m_startTime(std::chrono::steady_clock::now()),
+      m_rasterRevision(0)
+{
+    detail.resolution = options.resolution;
+    detail.wavefront = options.wavefront;
+    detail.sortMaterials = options.sortMaterials;
+    detail.adaptiveThreshold = options.adaptiveThreshold;
+    detail.sampleHeatmap = options.sampleHeatmap;
+    detail.denoise = options.denoise;
+    detail.temporal = options.temporal;
+    detail.rasterPrimary = options.rasterPrimary;
+
+    if (m_options.headless) {
+        // Offline runs trace every tile every frame.
+        detail.frameBudgetMs = 0;
+
+        // Without a display server use EGL directly; elsewhere fall back to
+        // a window that is never shown.
+        if (!m_headless.create(4, 3) && !createWindow(false)) {
+            printf("failed to create a headless OpenGL context\n");
+            exit(1);
+        }
+        GLCALL(glEnable(GL_BLEND));
+        GLCALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+        return;
+    }
 
-    glfwMakeContextCurrent(m_window);
-    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    if (!createWindow(true)) {
+        printf("failed to create a window\n");
+        exit(1);
+    }
 
     glfwSetWindowUserPointer(m_window, this);
     glfwSetKeyCallback(m_window, key_callback);
@@ -138,36 +172,73 @@ Application::Application() {
 }
 
 Application::~Application() {
-    ImGui_ImplGlfw_Shutdown();
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui::DestroyContext();
+    m_kernels.clear();
+    m_wavefront.release();
+    m_sampleStats.reset();
+    m_guideAlbedo.reset();
+    m_guideNormalDepth.reset();
+    m_historyColors.reset();
+    m_historyStats.reset();
+    m_historyNormalDepth.reset();
+    m_denoiser.release();
+    m_primaryRaster.release();
+    m_profiler.release();
+    m_frameUniforms.release();
+    if (!m_window) {
+        return;
+    }
+    if (!m_options.headless) {
+        ImGui_ImplGlfw_Shutdown();
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui::DestroyContext();
+    }
     glfwDestroyWindow(m_window);
     glfwTerminate();
 }
 
+bool Application::createWindow(bool visible) {
+    if (!glfwInit()) {
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+    m_window = glfwCreateWindow(detail.resolution.x, detail.resolution.y, "glsl test", NULL, NULL);
+    if (!m_window) {
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(m_window);
+    return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+}
+
 void Application::update() {
     float speed = 0.01;
     if (glfwGetKey(m_window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
         speed  *= 2;
 
     if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS) {
-        detail.frameIndex = 1;
+        detail.cameraMoved = true;
         world->cam.pos += world->cam.forward * speed;
     }
     if (glfwGetKey(m_window, GLFW_KEY_S) == GLFW_PRESS) {
-        detail.frameIndex = 1;
+        detail.cameraMoved = true;
         world->cam.pos -= world->cam.forward * speed;
     }
     if (glfwGetKey(m_window, GLFW_KEY_D) == GLFW_PRESS) {
-        detail.frameIndex = 1;
+        detail.cameraMoved = true;
         world->cam.pos += world->cam.right * speed;
     }
     if (glfwGetKey(m_window, GLFW_KEY_A) == GLFW_PRESS) {
-        detail.frameIndex = 1;
+        detail.cameraMoved = true;
         world->cam.pos -= world->cam.right * speed;
     }
     if (glfwGetKey(m_window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-        detail.frameIndex = 1;
+        detail.cameraMoved = true;
         world->cam.pos.y += speed;
     }
 }
@@ -182,6 +253,11 @@ void Application::imguiRender() {
     if (ImGui::SliderFloat("zoom", &world->cam.fov, 1, 179) ||
         ImGui::SliderInt("bounces", &world->cam.bounces, 1, 100) ||
         ImGui::SliderInt("rayPerPixel", &world->cam.rayPerPixel, 1, 10) ||
+        ImGui::Checkbox("lightSampling", &world->cam.lightSampling) ||
+        ImGui::Checkbox("russianRoulette", &world->cam.roulette) ||
+        ImGui::SliderInt("rouletteDepth", &world->cam.rouletteDepth, 1, 100) ||
+        ImGui::SliderFloat("rouletteMinSurvival", &world->cam.rouletteMinSurvival, 0.01, 1) ||
+        ImGui::Combo("sampler", &world->cam.sampler, "pcg\0sobol\0") ||
         ImGui::SliderFloat("gamma", &world->gamma, 1, 10) ||
         ImGui::SliderFloat("exposure", &world->exposure, 0, 10) ||
         ImGui::ColorEdit3("skyColor", glm::value_ptr(world->skyColor))
@@ -237,6 +313,7 @@ void Application::imguiRender() {
             ImGui::SliderFloat("specular", &materials[i].specular, 0, 1) ||
             ImGui::SliderFloat("specularTint", &materials[i].specularTint, 0, 1)) {
             detail.frameIndex = 1;
+            world->markMaterialDirty(i);
             hasChanged = true;
         }
         ImGui::PopID();
@@ -246,204 +323,560 @@ void Application::imguiRender() {
         world->updateBuffer();
     }
 
+    ImGui::SliderFloat("frameBudgetMs", &detail.frameBudgetMs, 0, 100);
+    ImGui::Text("tiles: %u of %u per frame, %u-%u samples", m_tiles.scheduledCount(), m_tiles.tileCount(),
+            m_tiles.minSamples(), m_tiles.maxSamples());
+
+    ImGui::Text("kernel variant: 0x%02x", m_options.uberKernel ? (u32)World::KERNEL_ALL | (world->kernelFeatures() & World::KERNEL_PACKED)
+                                                               : world->kernelFeatures());
+    ImGui::Checkbox("wavefront", &detail.wavefront);
+    ImGui::Checkbox("sortMaterials", &detail.sortMaterials);
+    if (ImGui::Checkbox("rasterPrimary", &detail.rasterPrimary)) {
+        detail.frameIndex = 1;
+    }
+    ImGui::SliderFloat("adaptiveThreshold", &detail.adaptiveThreshold, 0, 0.2f);
+    ImGui::SliderInt("adaptiveMinSamples", &detail.adaptiveMinSamples, 2, 64);
+    ImGui::Checkbox("sampleHeatmap", &detail.sampleHeatmap);
+    ImGui::Checkbox("temporal", &detail.temporal);
+    ImGui::SliderInt("maxHistory", &detail.maxHistory, 1, 256);
+    ImGui::SliderFloat("historyDepthTolerance", &detail.historyDepthTolerance, 0.001f, 0.5f);
+    ImGui::Checkbox("denoise", &detail.denoise);
+    ImGui::SliderInt("denoiseIterations", &detail.denoiseParams.iterations, 0, 8);
+    ImGui::SliderFloat("denoiseSigmaColor", &detail.denoiseParams.sigmaColor, 0.01f, 4);
+    ImGui::SliderFloat("denoiseSigmaNormal", &detail.denoiseParams.sigmaNormal, 1, 256);
+    ImGui::SliderFloat("denoiseSigmaDepth", &detail.denoiseParams.sigmaDepth, 0.001f, 1);
+    ImGui::SliderFloat("denoiseSigmaAlbedo", &detail.denoiseParams.sigmaAlbedo, 0.01f, 2);
+    ImGui::Text("gl calls: %llu per frame", (unsigned long long)detail.glCalls);
+#ifdef ALLOC_COUNTER
+    ImGui::Text("heap allocations: %llu per frame", (unsigned long long)detail.heapAllocations);
+#endif
+
+    // Results lag one frame behind; see gl::GpuProfiler.
+    ImGui::NewLine();
+    for (u32 i = 0; i < m_profiler.passCount(); ++i) {
+        ImGui::Text("gpu %s: %.3fms (avg %.3fms)", m_profiler.passName(i), m_profiler.lastMs(i), m_profiler.averageMs(i));
+    }
+
     ImGui::End();
 
     ImGui::Render();
+    m_profiler.begin("imgui");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    m_profiler.end();
 }
 
-void loadCornellBox(World* world, const glm::vec3& pos, float boxLen = 3, float lightLen = 0.7) {
-    glm::vec3 red = glm::vec3(.65, .05, .05);
-    glm::vec3 green = glm::vec3(.12, .45, .15);
-    glm::vec3 white = glm::vec3(1.0, 1.0, 1.0);
-
-    Material m;
-    m.roughness = 1.0;
-    m.albedo = glm::vec3(0);
-    m.emissionColor = {1, 1, 1};
-    m.emissionStrength = 20;
-
-    world->add<Quad>(
-            { {pos.x + boxLen * 0.5 + lightLen * 0.5, pos.y + boxLen - 0.000001, pos.z - lightLen * 0.5 - lightLen}, {-lightLen, 0, 0}, {0, 0, -lightLen} },
-            m, false 
-        );
-
-    m.emissionColor = {0, 0, 0};
-    m.emissionStrength = 0;
- 
-    m.albedo = white;
-    world->add<Quad>(
-            { {pos.x, pos.y, pos.z}, {boxLen, 0, 0}, {0, 0, -boxLen} },
-            m, false 
-        );
-
-    world->add<Quad>(
-            { {pos.x + boxLen, pos.y + boxLen, pos.z}, {-boxLen, 0, 0}, {0, 0, -boxLen} },
-            m, false 
-        );
-
-    world->add<Quad>(
-            { {pos.x + boxLen, pos.y, pos.z}, {-boxLen, 0, 0}, {0, boxLen, 0} },
-            m, false 
-        );
-
-    world->add<Quad>(
-            { {pos.x, pos.y, pos.z - boxLen}, {boxLen, 0, 0}, {0, boxLen, 0} },
-            m, false 
-        );
-
-    m.albedo = red;
-    world->add<Quad>(
-            { {pos.x, pos.y, pos.z - boxLen}, {0, boxLen, 0}, {0, 0, boxLen} },
-            m, false 
-        );
-
-    m.albedo = green;
-    world->add<Quad>(
-            { {pos.x + boxLen, pos.y, pos.z}, {0, boxLen, 0}, {0, 0, -boxLen} },
-            m, false 
-        );
+void Application::printFirstFrame() const {
+    // Context creation, scene loading, shader builds and the first frame's
+    // GPU work, i.e. what the binary and scene caches cut down.
+    printf("first frame %.2fms after start\n",
+            std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - m_startTime).count());
 }
 
-void loadBox(World* world, glm::vec2 len, glm::vec3 pos, float degree) {
-    glm::mat3 r = glm::rotate(glm::mat4(1), glm::radians(degree), {0, 1, 0});
-
-    glm::vec3 b1Vertex[] = {
-        glm::vec3{len.x, 0, len.x} * 0.5f * r,
-        glm::vec3{-len.x, 0, len.x} * 0.5f * r,
-        glm::vec3{-len.x, 0, -len.x} * 0.5f * r,
-        glm::vec3{len.x, 0, -len.x} * 0.5f * r,
-        glm::vec3{len.x, len.y * 2.0f, len.x} * 0.5f * r,
-        glm::vec3{-len.x, len.y * 2.0f, len.x} * 0.5f * r,
-        glm::vec3{-len.x, len.y * 2.0f, -len.x} * 0.5f * r,
-        glm::vec3{len.x, len.y * 2.0f, -len.x} * 0.5f * r,
+gl::ComputeShader& Application::kernel(u32 features, u32 stage) {
+    if (m_options.uberKernel) {
+        features = World::KERNEL_ALL | (features & World::KERNEL_PACKED);
+    }
+    const u32 key = features | stage << 8;
+    std::unordered_map<u32, std::unique_ptr<gl::ComputeShader>>::iterator it = m_kernels.find(key);
+    if (it != m_kernels.end()) {
+        return *it->second;
+    }
+
+    static const struct { u32 feature; const char* name; } defines[] = {
+        { World::KERNEL_SPHERES, "HAS_SPHERES" },
+        { World::KERNEL_QUADS, "HAS_QUADS" },
+        { World::KERNEL_MESHES, "HAS_MESHES" },
+        { World::KERNEL_EMISSIVE, "HAS_EMISSIVE" },
+        { World::KERNEL_SUBSURFACE, "HAS_SUBSURFACE" },
+        { World::KERNEL_INSTANCES, "HAS_INSTANCES" },
+        { World::KERNEL_PACKED, "PACKED_PRIMITIVES" },
     };
+    std::string source;
+    for (const auto& define : defines) {
+        source += std::string("#define ") + define.name + ((features & define.feature) ? " 1\n" : " 0\n");
+    }
+    source += "#define BVH_STACK_SIZE " + std::to_string(BVH::STACK_SIZE) + "\n";
+    if (stage) {
+        source += "#define WAVEFRONT_STAGE " + std::to_string(stage) + "\n#define TILE_SIZE " + std::to_string(TILE_SIZE) + "\n";
+    }
 
-    Material m;
-    m.roughness = 1;
-    m.albedo = glm::vec3(1);
-    world->add<Quad>(
-            { pos + b1Vertex[0], b1Vertex[4] - b1Vertex[0], b1Vertex[1] - b1Vertex[0]},
-            m, false
-        );
-
-    world->add<Quad>(
-            { pos + b1Vertex[1], b1Vertex[5] - b1Vertex[1], b1Vertex[2] - b1Vertex[1]},
-            m, false 
-        );
-
-    world->add<Quad>(
-            { pos + b1Vertex[2], b1Vertex[6] - b1Vertex[2], b1Vertex[3] - b1Vertex[2] },
-            m, false 
-        );
-
-    world->add<Quad>(
-            { pos + b1Vertex[3], b1Vertex[7] - b1Vertex[3], b1Vertex[0] - b1Vertex[3] },
-            m, false 
-        );
-
-    world->add<Quad>(
-            { pos + b1Vertex[4], b1Vertex[3] - b1Vertex[0], b1Vertex[1] - b1Vertex[0]},
-            m, false 
-        );
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point st = Clock::now();
+    gl::ComputeShader* compute = new gl::ComputeShader(SHADER_SOURCE_DIRECTORY "raytrace.comp", glm::vec3(1), source);
+    printf("raytrace.comp variant 0x%02x (%s) %s in %.2fms\n", features, Wavefront::stageName(stage),
+            compute->cached() ? "loaded from the binary cache" : "compiled",
+            std::chrono::duration<f64, std::milli>(Clock::now() - st).count());
+    m_kernels[key].reset(compute);
+    return *compute;
 }
 
-void loadScene1(World* world) {
-    Material m;
-    m.roughness = 1;
-    m.albedo = {0.7, 0.7, 0.7};
-    world->add<Sphere>(
-            { 50, {0, -50 - 0.2, 1.2}, 0 },
-            m, false
-        );
-    
-    m.emissionColor = {1, 1, 1};
-    m.emissionStrength = 30;
-    m.albedo = {0, 0, 0};
-    world->add<Sphere>(
-            { 1, {0, 3, 15}, 1 },
-            m, false
-        );
-    m.emissionColor = {0, 0, 0};
-    m.emissionStrength = 0;
-
-    m.albedo = {0.6, 0.3, 0.5};
-    world->add<Sphere>(
-            { 0.2, {0, 0, 1.2}, 2 },
-            m, false
-        );
-
-    m.albedo = {0.3, 0.8, 0.5};
-    world->add<Sphere>(
-            { 0.2, {0.5, 0, 1.2}, 2 },
-            m, false
-        );
+f64 Application::traceMs() const {
+    if (detail.wavefront) {
+        return m_wavefront.lastMs(m_profiler);
+    }
+    const i32 pass = m_profiler.findPass("raytrace");
+    return pass >= 0 ? m_profiler.lastMs((u32)pass) : 0;
 }
 
-void loadScene2(World* world) {
-    float boxLen = 3;
-    float lightLen = 0.9;
-    glm::vec3 pos = {-boxLen * 0.5, -boxLen * 0.5, 2 * boxLen};
-    glm::vec3 center = pos + glm::vec3{boxLen, 0, -boxLen} * 0.5f;
-    loadCornellBox(world, pos, boxLen, lightLen);
-
-    Material m;
-    m.roughness = 1;
-    m.albedo = {1, 1, 1};
-
-    world->add<Sphere>(
-            { 0.5, center + glm::vec3{0, 1, 0}, 2 },
-            m, false
-        );
+// Element `index` of the van der Corput sequence in `base`.
+static f32 radicalInverse(u32 index, u32 base) {
+    f32 result = 0, digit = 1.0f / base;
+    for (; index > 0; index /= base, digit /= base) {
+        result += (index % base) * digit;
+    }
+    return result;
 }
 
-void loadScene3(World* world) {
-    world->skyColor = { 0.0, 0.0, 0.0 };
-    world->cam.fov = 54;
+// Creates `image`, or resizes it, to be width x height.
+static void fitImage(std::unique_ptr<gl::Image2D>& image, i32 width, i32 height) {
+    if (!image) {
+        image.reset(new gl::Image2D(width, height));
+    }
+    else if (image->width() != width || image->height() != height) {
+        image->resize(width, height);
+    }
+}
 
-    float boxLen = 4;
-    float lightLen = 1.2;
-    glm::vec3 pos = {-boxLen * 0.5, -2, 2 * boxLen};
-    loadCornellBox(world, pos, boxLen, lightLen);
+void Application::dispatch(const gl::Image2D& screenImg) {
+    const u32 features = world->kernelFeatures();
+    gl::ComputeShader& compute = kernel(features);
+    gl::ComputeShader* stages[Wavefront::STAGE_END] = {};
+    if (detail.wavefront) {
+        for (u32 stage = Wavefront::Generate; stage < Wavefront::STAGE_END; ++stage) {
+            stages[stage] = &kernel(features, stage);
+        }
+    }
 
-    glm::vec2 b1Len = {1.2, 2.4};
-    glm::vec3 b1Pos = {1.2, 0, 1.3};
-    glm::vec3 b2Pos = {2.64, 0, 2.5};
-    loadBox(world, b1Len, {pos.x + b1Pos.x, pos.y + b1Pos.y, pos.z - b1Pos.z}, 18);
-    loadBox(world, {1.15, 1.15}, {pos.x + b2Pos.x, pos.y + b2Pos.y, pos.z - b2Pos.z}, -18);
+    // Camera motion reprojects the accumulation when temporal is on and
+    // there is one, and restarts it otherwise.
+    const bool reproject = detail.cameraMoved && detail.temporal && detail.frameIndex != 1 &&
+        m_tiles.resolution() == detail.resolution;
+    if (detail.cameraMoved && !reproject) {
+        detail.frameIndex = 1;
+    }
+    detail.cameraMoved = false;
+
+    if (m_tiles.resolution() != detail.resolution) {
+        m_tiles.resize(detail.resolution, TILE_SIZE);
+    }
+    else if (detail.frameIndex == 1) {
+        m_tiles.reset();
+    }
+
+    // Every region of the ring holds one FrameUniforms per batch of tiles,
+    // enough for all of them, so a frame is still a single write.
+    const u32 maxBatches = std::max(1u, (m_tiles.tileCount() + FrameUniforms::MAX_TILES - 1) / FrameUniforms::MAX_TILES);
+    if (maxBatches != m_frameBatches) {
+        if (!m_frameUniforms.create(maxBatches * sizeof(FrameUniforms), gl::PersistentBuffer::DEFAULT_REGIONS,
+                    gl::PersistentBuffer::Uniform)) {
+            printf("failed to create the frame uniform buffer\n");
+            exit(1);
+        }
+        m_frameBatches = maxBatches;
+    }
+
+    // The history only holds the frame before, so a reprojection traces
+    // every tile whatever the budget.
+    const std::vector<u32>& scheduled = m_tiles.schedule(m_profiler.frame(), reproject ? 0 : detail.frameBudgetMs);
+    const u32 batches = ((u32)scheduled.size() + FrameUniforms::MAX_TILES - 1) / FrameUniforms::MAX_TILES;
+
+    // The ring is mapped write-only, so the parameters are filled here and
+    // copied into every batch rather than read back from the first.
+    FrameParams params;
+    const World::Camera& cam = world->cam;
+    params.cam.position = cam.pos;
+    params.cam.fov = cam.fov;
+    params.cam.forward = cam.forward;
+    params.cam.bounces = cam.bounces;
+    params.cam.right = cam.right;
+    params.cam.rayPerPixel = cam.rayPerPixel;
+    params.cam.up = cam.up;
+    params.cam.lightSampling = cam.lightSampling;
+    params.cam.roulette = cam.roulette;
+    params.cam.rouletteDepth = cam.rouletteDepth;
+    params.cam.rouletteMinSurvival = cam.rouletteMinSurvival;
+    params.cam.sampler = cam.sampler;
+    params.skyColor = world->skyColor;
+    params.countRays = detail.countRays;
+    params.resolution = detail.resolution;
+    params.toneMappingMethodIdx = detail.toneMappingMethodIdx;
+    params.exposure = world->exposure;
+    params.gamma = world->gamma;
+    params.adaptiveThreshold = detail.adaptiveThreshold;
+    params.adaptiveMinSamples = detail.adaptiveMinSamples;
+    params.sampleHeatmap = detail.sampleHeatmap ? (i32)std::max(1u, m_tiles.maxSamples()) : 0;
+    params.history.position = m_lastCamera.pos;
+    params.history.fov = m_lastCamera.fov;
+    params.history.forward = m_lastCamera.forward;
+    params.history.reproject = reproject;
+    params.history.right = m_lastCamera.right;
+    params.history.maxHistory = detail.maxHistory;
+    params.history.up = m_lastCamera.up;
+    params.history.depthTolerance = detail.historyDepthTolerance;
+    m_lastCamera = cam;
+    // A Halton (2, 3) point per frame spreads the rasterized sample points
+    // over the pixel as the frames accumulate.
+    params.primaryJitter = glm::vec2(radicalInverse(detail.frameIndex, 2), radicalInverse(detail.frameIndex, 3));
+    params.rasterPrimary = detail.rasterPrimary;
+    FrameUniforms* frames = (FrameUniforms*)m_frameUniforms.begin();
+    for (u32 batch = 0; batch < std::max(1u, batches); ++batch) {
+        frames[batch].params = params;
+    }
+    for (u32 i = 0; i < scheduled.size(); ++i) {
+        const TileScheduler::Tile& tile = m_tiles.tile(scheduled[i]);
+        frames[i / FrameUniforms::MAX_TILES].tiles[i % FrameUniforms::MAX_TILES] =
+            glm::ivec4(tile.origin.x, tile.origin.y, tile.sampleCount + 1, 0);
+        m_tiles.traced(scheduled[i]);
+    }
+    m_frameUniforms.end(std::max(1u, batches) * sizeof(FrameUniforms));
+
+    fitImage(m_sampleStats, screenImg.width(), screenImg.height());
+    fitImage(m_guideAlbedo, screenImg.width(), screenImg.height());
+    fitImage(m_guideNormalDepth, screenImg.width(), screenImg.height());
+    if (reproject) {
+        // The kernels overwrite the images they reproject from.
+        fitImage(m_historyColors, screenImg.width(), screenImg.height());
+        fitImage(m_historyStats, screenImg.width(), screenImg.height());
+        fitImage(m_historyNormalDepth, screenImg.width(), screenImg.height());
+        screenImg.copyTo(*m_historyColors);
+        m_sampleStats->copyTo(*m_historyStats);
+        m_guideNormalDepth->copyTo(*m_historyNormalDepth);
+        m_historyColors->bind(4, GL_READ_ONLY);
+        m_historyStats->bind(5, GL_READ_ONLY);
+        m_historyNormalDepth->bind(6, GL_READ_ONLY);
+    }
+
+    if (detail.rasterPrimary) {
+        // Edited spheres and quads must be redrawn from their new vertices.
+        if (world->getGeometryRevision() != m_rasterRevision) {
+            m_primaryRaster.invalidate();
+            m_rasterRevision = world->getGeometryRevision();
+        }
+        m_primaryRaster.render(*world, cam, glm::ivec2(screenImg.width(), screenImg.height()), params.primaryJitter,
+                m_profiler);
+        m_primaryRaster.bindRefs(PRIMARY_REFS_UNIT);
+    }
+
+    world->bindBuffer();
+    screenImg.bind(0);
+    m_sampleStats->bind(1);
+    m_guideAlbedo->bind(2);
+    m_guideNormalDepth->bind(3);
+
+    if (detail.wavefront) {
+        // Same sample grid as the megakernel.
+        const u32 samplesPerAxis = (u32)std::sqrt((f32)cam.rayPerPixel);
+        for (u32 batch = 0; batch < batches; ++batch) {
+            const u32 count = std::min((u32)scheduled.size() - batch * FrameUniforms::MAX_TILES, FrameUniforms::MAX_TILES);
+            m_frameUniforms.binding(FRAME_UNIFORM_BINDING, batch * sizeof(FrameUniforms), sizeof(FrameUniforms));
+            m_wavefront.trace(stages, count * TILE_SIZE * TILE_SIZE, samplesPerAxis * samplesPerAxis,
+                    (u32)std::max(0, cam.bounces), detail.sortMaterials, m_profiler);
+        }
+    }
+    else {
+        // One work group layer per tile.
+        compute.bind();
+        m_profiler.begin("raytrace");
+        for (u32 batch = 0; batch < batches; ++batch) {
+            const u32 count = std::min((u32)scheduled.size() - batch * FrameUniforms::MAX_TILES, FrameUniforms::MAX_TILES);
+            m_frameUniforms.binding(FRAME_UNIFORM_BINDING, batch * sizeof(FrameUniforms), sizeof(FrameUniforms));
+            compute.updateGroups({ TILE_SIZE / 16, TILE_SIZE / 16, count });
+            compute.use();
+        }
+        m_profiler.end();
+    }
+    m_frameUniforms.fence();
+    world->unbindBuffer();
+
+    if (detail.denoise) {
+        m_denoiser.apply(screenImg, *m_guideAlbedo, *m_guideNormalDepth, detail.denoiseParams, m_profiler);
+    }
+}
+
+const gl::Image2D& Application::displayImage(const gl::Image2D& screenImg) const {
+    return detail.denoise && m_denoiser.output() ? *m_denoiser.output() : screenImg;
 }
 
-void RoughnessMetallicTest(World *world) {
-    Material m;
-    m.roughness = 1.0;
-    int groundLen = 10;
-    world->add<Quad>(
-            { {groundLen * 0.5, -0.1 - 1, groundLen * 0.5}, {0, 0, -groundLen}, {-groundLen, 0, 0} }, m, false );
-
-    glm::vec3 red = glm::vec3(.65, .05, .05);
-    m.albedo = red;
-    m.specular = 1;
-    for (int i = 0; i <= 10; ++i) {
-        for (int j = 0; j < 2; ++j) {
-            m.roughness = i / 10.0;
-            m.metallic = j * (1 - i / 10.0);
-            world->add<Sphere>(
-                    { 0.1, {i * 0.3 - groundLen * 0.5 * 0.3, -1, 2 - j * 0.5} }, m, false);
+void Application::drawScreen(gl::ShaderProgram& screenShader, const gl::Image2D& screenImg) {
+    quad->vao.bind();
+    screenShader.bind();
+    displayImage(screenImg).bindTexture(0);
+    m_sampleStats->bindTexture(1);
+    // Tone mapping reads the parameters dispatch() wrote for this frame.
+    m_frameUniforms.binding(FRAME_UNIFORM_BINDING, 0, sizeof(FrameParams));
+    m_profiler.begin("screen");
+    GLCALL(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+    m_profiler.end();
+    m_frameUniforms.fence();
+    quad->vao.unbind();
+}
+
+u64 Application::samplesTaken() const {
+    std::vector<f32> stats;
+    m_sampleStats->read(stats);
+    u64 frames = 0;
+    for (size_t i = 0; i < stats.size(); i += 4) {
+        frames += (u64)stats[i];
+    }
+    // Same sample grid as the kernel.
+    const u32 samplesPerAxis = (u32)std::sqrt((f32)world->cam.rayPerPixel);
+    return frames * samplesPerAxis * samplesPerAxis;
+}
+
+int Application::runHeadless(gl::ShaderProgram& screenShader, const gl::Image2D& screenImg) {
+    typedef std::chrono::steady_clock Clock;
+
+    // glFinish() after every dispatch so the time covers the GPU work and
+    // not just the submission.
+    f64 total = 0, submitTotal = 0;
+    const u64 callsBefore = gl::GLCallCount();
+    // The first frame creates the tiles and the frame uniform ring; later
+    // ones should not allocate.
+    const u64 allocationsBefore = heapAllocationCount();
+    u64 allocationsFirst = 0;
+    // Counted apart from frameIndex, which camera motion may restart.
+    detail.frameIndex = 1;
+    for (u32 frame = 1; frame <= m_options.frames; ++frame, ++detail.frameIndex) {
+        if (frame > 1 && m_options.pan != 0) {
+            turnCamera(m_options.pan, 0);
+        }
+        Clock::time_point st = Clock::now();
+        dispatch(screenImg);
+        submitTotal += std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+        GLCALL(glFinish());
+        f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+        total += ms;
+        m_profiler.endFrame();
+        printf("frame %u: %.2fms\n", frame, ms);
+        if (frame == 1) {
+            allocationsFirst = heapAllocationCount();
+            printFirstFrame();
         }
     }
+    m_profiler.finish();
+    printf("%u frames at %dx%d: %.2fms/frame\n", m_options.frames,
+            detail.resolution.x, detail.resolution.y, total / m_options.frames);
+    // The glFinish() per frame is counted too.
+    printf("cpu submit: %.3fms/frame, %.1f gl calls/frame\n", submitTotal / m_options.frames,
+            (f64)(gl::GLCallCount() - callsBefore) / m_options.frames);
+#ifdef ALLOC_COUNTER
+    printf("heap allocations: %llu in frame 1, %.1f/frame after\n", (unsigned long long)(allocationsFirst - allocationsBefore),
+            m_options.frames > 1 ? (f64)(heapAllocationCount() - allocationsFirst) / (m_options.frames - 1) : 0.0);
+#endif
+    if (detail.adaptiveThreshold > 0) {
+        // Against tracing every pixel every frame at the same settings.
+        const u64 taken = samplesTaken();
+        const u32 samplesPerAxis = (u32)std::sqrt((f32)world->cam.rayPerPixel);
+        const u64 uniform = (u64)m_options.frames * detail.resolution.x * detail.resolution.y * samplesPerAxis * samplesPerAxis;
+        printf("adaptive sampling: %llu of %llu samples (%.1f%%)\n", (unsigned long long)taken,
+                (unsigned long long)uniform, 100.0 * taken / uniform);
+    }
+    if (detail.denoise) {
+        // The GPU filter against cpu::denoise() on the same inputs.
+        std::vector<f32> color, albedo, normalDepth, denoised;
+        screenImg.read(color);
+        m_guideAlbedo->read(albedo);
+        m_guideNormalDepth->read(normalDepth);
+        displayImage(screenImg).read(denoised);
+        std::vector<glm::vec4> reference;
+        cpu::denoise(detail.denoiseParams, screenImg.width(), screenImg.height(), (const glm::vec4*)color.data(),
+                (const glm::vec4*)albedo.data(), (const glm::vec4*)normalDepth.data(), reference);
+        f64 maxError = 0;
+        for (size_t i = 0; i < reference.size(); ++i) {
+            for (u32 c = 0; c < 3; ++c) {
+                const f64 expected = reference[i][c];
+                maxError = std::max(maxError, std::abs(denoised[i * 4 + c] - expected) / std::max(1.0, std::abs(expected)));
+            }
+        }
+        printf("denoise: %.2e max relative difference to the cpu reference\n", maxError);
+    }
+    for (u32 i = 0; i < m_profiler.passCount(); ++i) {
+        printf("gpu %s: %.3fms last, %.3fms avg\n", m_profiler.passName(i), m_profiler.lastMs(i), m_profiler.averageMs(i));
+    }
+
+    const std::string& output = m_options.output;
+    if (output.empty()) {
+        return 0;
+    }
+
+    bool written = false;
+    if (output.size() > 4 && output.compare(output.size() - 4, 4, ".png") == 0) {
+        // Run the same tone mapping pass as the window into an 8-bit target.
+        gl::Texture2D target(detail.resolution.x, detail.resolution.y, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        gl::FrameBufferObject fbo(target);
+        GLCALL(glViewport(0, 0, detail.resolution.x, detail.resolution.y));
+        drawScreen(screenShader, screenImg);
+
+        std::vector<u8> pixels((size_t)detail.resolution.x * detail.resolution.y * 4);
+        GLCALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        GLCALL(glReadPixels(0, 0, detail.resolution.x, detail.resolution.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+        fbo.unbind();
+        written = writePNG(output, detail.resolution.x, detail.resolution.y, pixels.data());
+    }
+    else {
+        std::vector<f32> pixels;
+        displayImage(screenImg).read(pixels);
+        written = writeImage(output, screenImg.width(), screenImg.height(), pixels.data(), world->gamma);
+    }
 
-    m.emissionColor = {1, 1, 1};
-    m.emissionStrength = 300;
-    m.albedo = {0, 0, 0};
-    world->add<Sphere>(
-            { 1, {-5, 8, -15}, 1 },
-            m, false
-        );
-    m.emissionColor = {0, 0, 0};
-    m.emissionStrength = 0;
+    if (!written) {
+        printf("failed to write '%s'\n", output.c_str());
+        return 1;
+    }
+    printf("wrote %s\n", output.c_str());
+    return 0;
 }
 
-void Application::run() {
+int Application::runBench() {
+    typedef std::chrono::steady_clock Clock;
+
+    // A single uint the kernel adds its traced rays to.
+    const u32 zero = 0;
+    gl::ShaderStorageBuffer rayCounter(&zero, sizeof(zero));
+    rayCounter.binding(RAY_COUNTER_BINDING);
+    detail.countRays = true;
+
+    std::vector<BenchResult> results;
+    for (u32 i = 0; i < benchCaseCount; ++i) {
+        const BenchCase& bench = benchCases[i];
+        World benchWorld;
+        if (!loadBenchCase(&benchWorld, bench)) {
+            printf("unknown scene '%s'\n", bench.scene);
+            return 1;
+        }
+        world = &benchWorld;
+        world->setPackedPrimitives(m_options.packedPrimitives);
+        world->fetchBuffer();
+        m_primaryRaster.invalidate();
+        detail.resolution = bench.resolution;
+        gl::Image2D screenImg(bench.resolution.x, bench.resolution.y);
+
+        // One untimed frame takes shader compilation and first-touch costs.
+        detail.frameIndex = 1;
+        dispatch(screenImg);
+        GLCALL(glFinish());
+
+        BenchResult result;
+        result.bench = bench;
+        for (u32 frame = 0; frame < bench.frames; ++frame) {
+            ++detail.frameIndex;
+            rayCounter.updateBuffer(&zero, sizeof(zero));
+
+            Clock::time_point st = Clock::now();
+            dispatch(screenImg);
+            GLCALL(glFinish());
+            result.totalMs += std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+
+            u32 rays = 0;
+            rayCounter.read(&rays, sizeof(rays));
+            result.rays += rays;
+        }
+        result.samples = benchSamplesPerFrame(bench) * bench.frames;
+        results.push_back(result);
+        world = nullptr;
+    }
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    if (!writeBenchReport(m_options.output, !detail.wavefront ? "gpu" : detail.sortMaterials ? "gpu-wavefront-sorted" : "gpu-wavefront", renderer ? renderer : "unknown", results)) {
+        printf("failed to write '%s'\n", m_options.output.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Writes one frame of benchmark payload and returns the XOR of its words,
+// which upload.comp folds into the same checksum on the GPU.
+static u32 fillPayload(u32* words, u32 count, u32 frame) {
+    const u32 salt = frame * 0x9e3779b9u;
+    u32 sum = 0;
+    for (u32 i = 0; i < count; ++i) {
+        words[i] = i * 2654435761u ^ salt;
+        sum ^= words[i];
+    }
+    return sum;
+}
+
+int Application::runUploadBench() {
+    typedef std::chrono::steady_clock Clock;
+    static const u32 payloadSizes[] = { 64 << 10, 1 << 20, 8 << 20 };
+    static const u32 frames = 64;
+    static const u32 groups = 64;
+
+    gl::ComputeShader compute(SHADER_SOURCE_DIRECTORY "upload.comp", glm::vec3(groups, 1, 1));
+    const gl::Uniform<u32> wordCount = compute.get_uniform<u32>("wordCount");
+    const u32 zero = 0;
+    gl::ShaderStorageBuffer checksum(&zero, sizeof(zero));
+    checksum.binding(1);
+
+    printf("persistent mapping: %s\n", GLAD_GL_VERSION_4_4 ? "yes" : "no (GL 4.4 missing)");
+    bool valid = true;
+    for (u32 size : payloadSizes) {
+        const u32 count = size / sizeof(u32);
+        compute.bind();
+        compute.set(wordCount, count);
+
+        // The current path fills a CPU copy and glBufferSubData()s it into
+        // the one buffer the previous dispatch may still be reading; the
+        // persistent one writes straight into a free region of the ring.
+        for (u32 pass = 0; pass < 2; ++pass) {
+            const bool persistent = pass == 1;
+            gl::ShaderStorageBuffer buffer;
+            gl::PersistentBuffer ring;
+            std::vector<u32> staging;
+            if (!persistent) {
+                buffer.setBuffer(nullptr, size);
+                staging.resize(count);
+            }
+            else if (!ring.create(size)) {
+                printf("failed to create a persistent buffer\n");
+                return 1;
+            }
+
+            checksum.updateBuffer(&zero, sizeof(zero));
+            GLCALL(glFinish());
+
+            u32 expected = 0;
+            Clock::time_point st = Clock::now();
+            for (u32 frame = 0; frame < frames; ++frame) {
+                if (persistent) {
+                    expected ^= fillPayload((u32*)ring.begin(), count, frame);
+                    ring.end(size);
+                    ring.binding(0);
+                }
+                else {
+                    expected ^= fillPayload(staging.data(), count, frame);
+                    buffer.updateBuffer(staging.data(), size);
+                    buffer.binding(0);
+                }
+                compute.use();
+                if (persistent) {
+                    ring.fence();
+                }
+            }
+            GLCALL(glFinish());
+            const f64 totalMs = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+
+            u32 result = 0;
+            checksum.read(&result, sizeof(result));
+            valid = valid && result == expected;
+            printf("%-10s %6u KiB %7.3fms/frame %7.2f GB/s %3u waits%s\n", persistent ? "persistent" : "subdata",
+                    size >> 10, totalMs / frames, (f64)size * frames / (totalMs * 1e6),
+                    persistent ? ring.waits() : 0u, result == expected ? "" : "  checksum mismatch");
+        }
+    }
+    return valid ? 0 : 1;
+}
+
+int Application::run() {
+    gl::ShaderProgram::set_binary_cache(m_options.shaderCache);
+
+    if (m_options.bench) {
+        return runBench();
+    }
+    if (m_options.benchUpload) {
+        return runUploadBench();
+    }
+
     gl::ShaderProgram screenShader;
     screenShader.attach_shader(GL_VERTEX_SHADER, SHADER_SOURCE_DIRECTORY "screen.vert");
     screenShader.attach_shader(GL_FRAGMENT_SHADER, SHADER_SOURCE_DIRECTORY "screen.frag");
@@ -459,59 +892,56 @@ void Application::run() {
 
     GLCALL(glClearColor(0.1, 0.1, 0.1, 1));
 
-    // loadScene1(world);
-    // loadScene2(world);
-    loadScene3(world);
-
-    // RoughnessMetallicTest(world);
-
-    glm::vec3 dispatchGroups = { (detail.resolution.x + 15) / 16, (detail.resolution.y + 15) / 16, 1 };
+    if (!loadWorld(world, m_options)) {
+        return 1;
+    }
+    world->cam.lightSampling = m_options.lightSampling;
+    world->cam.roulette = m_options.roulette;
+    world->cam.sampler = m_options.sampler;
+    world->setPackedPrimitives(m_options.packedPrimitives);
+    if (m_options.bounces > 0) {
+        world->cam.bounces = m_options.bounces;
+    }
 
-    gl::ComputeShader compute(SHADER_SOURCE_DIRECTORY "raytrace.comp", dispatchGroups);
+    // Builds the scene's kernel variant up front; later ones are compiled
+    // the first time the scene needs them.
+    kernel(world->kernelFeatures());
+    for (u32 stage = Wavefront::Generate; detail.wavefront && stage < Wavefront::STAGE_END; ++stage) {
+        kernel(world->kernelFeatures(), stage);
+    }
     gl::Image2D screenImg(detail.resolution.x, detail.resolution.y);
 
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point uploadStart = Clock::now();
     world->fetchBuffer();
+    GLCALL(glFinish());
+    printf("scene uploaded in %.2fms\n", std::chrono::duration<f64, std::milli>(Clock::now() - uploadStart).count());
+    world->report();
+
+    if (!m_options.profile.empty() && !m_profiler.openCsv(m_options.profile)) {
+        printf("failed to open '%s'\n", m_options.profile.c_str());
+        return 1;
+    }
 
+    if (m_options.headless) {
+        return runHeadless(screenShader, screenImg);
+    }
+
+    i32 measuredFrame = -1;
     while(!glfwWindowShouldClose(m_window))
     {
         static double st;
         st = glfwGetTime();
 
-        world->bindBuffer();
-        dispatchGroups = { (detail.resolution.x + 15) / 16, (detail.resolution.y + 15) / 16, 1 };
-        compute.updateGroups(dispatchGroups);
-        compute.bind();
-        screenImg.bind(0);
-        compute.set_1u("frameIndex", detail.frameIndex);
-        compute.set_3f("skyColor", world->skyColor);
-
-        compute.set_1f("cam.fov", world->cam.fov);
-        compute.set_3f("cam.position", world->cam.pos);
-        compute.set_3f("cam.forward", world->cam.forward);
-        compute.set_3f("cam.right", world->cam.right);
-        compute.set_3f("cam.up", world->cam.up);
-
-        compute.set_1i("cam.bounces", world->cam.bounces);
-        compute.set_1i("cam.rayPerPixel", world->cam.rayPerPixel);
-
-        compute.use();
-        world->unbindBuffer();
-
-        quad->vao.bind();
-        screenShader.bind();
-        screenImg.bindTexture(0);
-        screenShader.set_2f("resolution", detail.resolution);
-        screenShader.set_1i("tex", 0);
-        screenShader.set_1i("toneMappingMethodIdx", detail.toneMappingMethodIdx);
-        screenShader.set_1f("exposure", world->exposure);
-        screenShader.set_1f("gamma", world->gamma);
-        GLCALL(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
-        quad->vao.unbind();
-
-        std::stringstream ss;
-        ss << "render: " << (glfwGetTime() - st) * 1000.0 << "ms"
-                        << " frameIndex: " << std::to_string(detail.frameIndex);
-        glfwSetWindowTitle(m_window, ss.str().c_str());
+        const u64 allocations = heapAllocationCount();
+        const u64 calls = gl::GLCallCount();
+        dispatch(screenImg);
+        drawScreen(screenShader, screenImg);
+        detail.glCalls = gl::GLCallCount() - calls;
+
+        char title[96];
+        snprintf(title, sizeof(title), "render: %gms frameIndex: %u", (glfwGetTime() - st) * 1000.0, detail.frameIndex);
+        glfwSetWindowTitle(m_window, title);
 
         ++detail.frameIndex;
 
@@ -526,6 +956,18 @@ void Application::run() {
         imguiRender();
 
         glfwSwapBuffers(m_window);
+        if (m_profiler.frame() == 0) {
+            GLCALL(glFinish());
+            printFirstFrame();
+        }
+        m_profiler.endFrame();
+
+        // Teach the scheduler what a tile costs once the frame's timing
+        // comes back.
+        if (m_profiler.resultFrame() >= 0 && m_profiler.resultFrame() != measuredFrame) {
+            measuredFrame = m_profiler.resultFrame();
+            m_tiles.measured((u32)measuredFrame, traceMs());
+        }
         glm::ivec2 tmp = detail.resolution;
         glfwPollEvents();
 
@@ -533,6 +975,7 @@ void Application::run() {
             screenImg.resize(detail.resolution.x, detail.resolution.y);
             detail.frameIndex = 1;
         }
+        detail.heapAllocations = heapAllocationCount() - allocations;
     }
+    return 0;
 }
-
@@ -1,14 +1,58 @@
 #pragma once
+#include <chrono>
+#include <memory>
+#include <unordered_map>
 #include "OpenGL/Quad.h"
 #include "stb_image.h"
 #include "glfw3.h"
 #include "imgui/imgui.h"
 #include "World.h"
+#include "Options.h"
+#include "OpenGL/HeadlessContext.h"
+#include "OpenGL/ComputeShader.h"
+#include "OpenGL/Image2D.h"
+#include "OpenGL/GpuProfiler.h"
+#include "OpenGL/PersistentBuffer.h"
+#include "FrameUniforms.h"
+#include "TileScheduler.h"
+#include "Wavefront.h"
+#include "Denoiser.h"
+#include "PrimaryRaster.h"
 
 class Application {
 private:
     GLFWwindow* m_window;
+    gl::HeadlessContext m_headless;
     ImGuiIO m_imguiIO;
+    Options m_options;
+    gl::GpuProfiler m_profiler;
+    TileScheduler m_tiles;
+    // Per-frame FrameUniforms, see dispatch().
+    gl::PersistentBuffer m_frameUniforms;
+    u32 m_frameBatches;
+    std::chrono::steady_clock::time_point m_startTime;
+    // raytrace.comp variants by World::kernelFeatures() mask and
+    // Wavefront::Stage, see kernel().
+    std::unordered_map<u32, std::unique_ptr<gl::ComputeShader>> m_kernels;
+    Wavefront m_wavefront;
+    // Per-pixel sample statistics for adaptive sampling, sized like the
+    // screen image by dispatch().
+    std::unique_ptr<gl::Image2D> m_sampleStats;
+    // First-hit guides raytrace.comp writes for the denoiser, sized the
+    // same way.
+    std::unique_ptr<gl::Image2D> m_guideAlbedo;
+    std::unique_ptr<gl::Image2D> m_guideNormalDepth;
+    // Copies of the screen image, sample statistics and normal guide the
+    // kernels reproject from after the camera moved, and the camera they
+    // were rendered with.
+    std::unique_ptr<gl::Image2D> m_historyColors;
+    std::unique_ptr<gl::Image2D> m_historyStats;
+    std::unique_ptr<gl::Image2D> m_historyNormalDepth;
+    World::Camera m_lastCamera;
+    Denoiser m_denoiser;
+    PrimaryRaster m_primaryRaster;
+    // World::getGeometryRevision() m_primaryRaster was last drawn with.
+    u32 m_rasterRevision;
 
     friend void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
     friend void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -20,18 +64,69 @@ private:
         glm::ivec2 resolution;
         bool focus = true;
         int toneMappingMethodIdx = 0;
+        // Frames since the image was last reset; 1 restarts accumulation.
         unsigned int frameIndex = 1;
+        // Set by camera input; the next dispatch() reprojects or restarts
+        // the accumulation.
+        bool cameraMoved = false;
+        // Reproject the accumulation on camera motion instead of
+        // restarting it, see reprojectHistory() in raytrace.comp.
+        bool temporal = true;
+        int maxHistory = 32;
+        float historyDepthTolerance = 0.05f;
+        // GPU time the raytrace pass may take per frame, 0 for the whole
+        // image every frame.
+        float frameBudgetMs = 16;
+        bool countRays = false;
+        // Trace with the wavefront passes instead of the megakernel.
+        bool wavefront = false;
+        // Shade the wavefront's hits in material order.
+        bool sortMaterials = false;
+        // Rasterize the camera rays' first hits, see PrimaryRaster.h.
+        bool rasterPrimary = false;
+        // Adaptive sampling, see the Frame block in raytrace.comp.
+        float adaptiveThreshold = 0;
+        int adaptiveMinSamples = 8;
+        // Shows the frames each pixel took instead of the image.
+        bool sampleHeatmap = false;
+        // Shows the image through the denoiser.
+        bool denoise = false;
+        DenoiseParams denoiseParams;
+        // GLCALLs made by dispatch() and drawScreen() last frame.
+        u64 glCalls = 0;
+        // Heap allocations of the last render loop iteration, see AllocCounter.h.
+        u64 heapAllocations = 0;
     } detail;
 
     World* world;
 
+    bool createWindow(bool visible);
     void update();
+    // Turns the camera by `yaw` and `pitch` degrees.
+    void turnCamera(float yaw, float pitch);
     void imguiRender();
 
+    void printFirstFrame() const;
+    // The kernel variant for `features` and wavefront `stage` (0 for the
+    // megakernel), compiled on first use.
+    gl::ComputeShader& kernel(u32 features, u32 stage = 0);
+    // GPU time of the last profiled frame's trace passes.
+    f64 traceMs() const;
+    void dispatch(const gl::Image2D& screenImg);
+    // The image drawScreen() shows: the denoised one when denoising.
+    const gl::Image2D& displayImage(const gl::Image2D& screenImg) const;
+    void drawScreen(gl::ShaderProgram& screenShader, const gl::Image2D& screenImg);
+    // Pixel samples taken since the image was last reset, summed over the
+    // sample statistics.
+    u64 samplesTaken() const;
+    int runHeadless(gl::ShaderProgram& screenShader, const gl::Image2D& screenImg);
+    int runBench();
+    int runUploadBench();
+
 public:
-    Application();
+    explicit Application(const Options& options);
     ~Application();
 
-    void run();
+    int run();
 
 };
@@ -0,0 +1,30 @@
+#ifndef ARRAY_VIEW_H
+#define ARRAY_VIEW_H
+
+#include <cstddef>
+#include <vector>
+
+// Read-only pointer and length over memory owned elsewhere, either a
+// vector or a mapped file.
+template <typename T>
+struct ArrayView {
+    const T* ptr = nullptr;
+    size_t count = 0;
+
+    ArrayView() = default;
+    ArrayView(const T* ptr, size_t count)
+        : ptr(ptr), count(count)
+    {}
+    ArrayView(const std::vector<T>& v)
+        : ptr(v.data()), count(v.size())
+    {}
+
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+};
+
+#endif
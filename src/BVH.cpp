@@ -0,0 +1,190 @@
+#include "BVH.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// SAH costs relative to one primitive test. A node visit fetches 32 bytes
+// and tests two more boxes; weighting it higher also keeps large meshes at
+// a few triangles per leaf rather than one, roughly halving node memory.
+static const f32 TRAVERSAL_COST = 4.0f;
+static const f32 INTERSECTION_COST = 1.0f;
+
+static Bounds nodeBounds(const BVHNode& node) {
+    return Bounds(node.min, node.max);
+}
+
+void BVH::clear() {
+    nodes.clear();
+    indices.clear();
+    stats = Stats();
+}
+
+struct BVH::BuildPrim {
+    Bounds bounds;
+    glm::vec3 centroid;
+    u32 index;
+};
+
+void BVH::build(const std::vector<Bounds>& primBounds, u32 maxLeafSize) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point st = Clock::now();
+
+    clear();
+    const u32 count = (u32)primBounds.size();
+    stats.primitives = count;
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<BuildPrim> prims(count);
+    for (u32 i = 0; i < count; ++i) {
+        prims[i].bounds = primBounds[i];
+        prims[i].centroid = primBounds[i].center();
+        prims[i].index = i;
+    }
+
+    nodes.reserve(count * 2);
+    BVHNode root;
+    root.leftFirst = 0;
+    root.count = (i32)count;
+    nodes.push_back(root);
+    subdivide(0, 1, maxLeafSize, prims);
+    nodes.shrink_to_fit();
+
+    indices.resize(count);
+    for (u32 i = 0; i < count; ++i) {
+        indices[i] = prims[i].index;
+    }
+
+    const f32 rootArea = std::max(nodeBounds(nodes[0]).area(), 1e-12f);
+    stats.nodes = (u32)nodes.size();
+    for (const BVHNode& node : nodes) {
+        f32 relArea = nodeBounds(node).area() / rootArea;
+        if (node.count > 0) {
+            ++stats.leaves;
+            stats.maxLeafSize = std::max(stats.maxLeafSize, (u32)node.count);
+            stats.sahCost += INTERSECTION_COST * node.count * relArea;
+        }
+        else {
+            stats.sahCost += TRAVERSAL_COST * relArea;
+        }
+    }
+    stats.buildMs = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+}
+
+void BVH::subdivide(u32 nodeIdx, u32 depth, u32 maxLeafSize, std::vector<BuildPrim>& prims) {
+    stats.maxDepth = std::max(stats.maxDepth, depth);
+
+    const u32 first = nodes[nodeIdx].leftFirst;
+    const u32 count = nodes[nodeIdx].count;
+    BuildPrim* begin = &prims[first];
+    BuildPrim* end = begin + count;
+
+    Bounds bounds, centroidBounds;
+    for (const BuildPrim* prim = begin; prim != end; ++prim) {
+        bounds.grow(prim->bounds);
+        centroidBounds.grow(prim->centroid);
+    }
+    nodes[nodeIdx].min = bounds.min;
+    nodes[nodeIdx].max = bounds.max;
+
+    if (count <= 1 || depth >= MAX_DEPTH) {
+        return;
+    }
+
+    // Bin every axis in one pass, then evaluate binCount - 1 candidate
+    // planes on each. Small nodes, the bulk of a large tree, get fewer bins
+    // since they cannot fill more.
+    const u32 bins = std::min(BIN_COUNT, std::max(4u, count));
+    const glm::vec3 lo = centroidBounds.min;
+    const glm::vec3 extent = centroidBounds.max - lo;
+    glm::vec3 scale;
+    for (i32 axis = 0; axis < 3; ++axis) {
+        scale[axis] = extent[axis] > 0 ? bins / extent[axis] : 0.0f;
+    }
+
+    Bounds binBounds[3][BIN_COUNT];
+    u32 binCount[3][BIN_COUNT] = {};
+    for (const BuildPrim* prim = begin; prim != end; ++prim) {
+        for (i32 axis = 0; axis < 3; ++axis) {
+            u32 b = std::min(bins - 1, (u32)((prim->centroid[axis] - lo[axis]) * scale[axis]));
+            ++binCount[axis][b];
+            binBounds[axis][b].grow(prim->bounds);
+        }
+    }
+
+    f32 bestCost = 1e30f;
+    i32 bestAxis = -1;
+    u32 bestSplit = 0;
+    for (i32 axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0) {
+            continue;
+        }
+
+        f32 leftArea[BIN_COUNT - 1];
+        u32 leftCount[BIN_COUNT - 1];
+        Bounds acc;
+        u32 sum = 0;
+        for (u32 b = 0; b < bins - 1; ++b) {
+            acc.grow(binBounds[axis][b]);
+            sum += binCount[axis][b];
+            leftArea[b] = acc.area();
+            leftCount[b] = sum;
+        }
+
+        acc = Bounds();
+        sum = 0;
+        for (u32 b = bins - 1; b > 0; --b) {
+            acc.grow(binBounds[axis][b]);
+            sum += binCount[axis][b];
+            if (leftCount[b - 1] == 0 || sum == 0) {
+                continue;
+            }
+            f32 cost = leftCount[b - 1] * leftArea[b - 1] + sum * acc.area();
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    if (bestAxis < 0) {
+        return;
+    }
+
+    const f32 area = bounds.area();
+    const f32 leafCost = INTERSECTION_COST * count * area;
+    const f32 splitCost = TRAVERSAL_COST * area + INTERSECTION_COST * bestCost;
+    if (splitCost >= leafCost && count <= maxLeafSize) {
+        return;
+    }
+
+    const f32 axisLo = lo[bestAxis];
+    const f32 axisScale = scale[bestAxis];
+    BuildPrim* mid = std::partition(begin, end, [&](const BuildPrim& prim) {
+        return std::min(bins - 1, (u32)((prim.centroid[bestAxis] - axisLo) * axisScale)) < bestSplit;
+    });
+    const u32 leftCount = (u32)(mid - begin);
+
+    const u32 left = (u32)nodes.size();
+    BVHNode child;
+    child.leftFirst = first;
+    child.count = leftCount;
+    nodes.push_back(child);
+    child.leftFirst = first + leftCount;
+    child.count = count - leftCount;
+    nodes.push_back(child);
+
+    nodes[nodeIdx].leftFirst = left;
+    nodes[nodeIdx].count = 0;
+
+    subdivide(left, depth + 1, maxLeafSize, prims);
+    subdivide(left + 1, depth + 1, maxLeafSize, prims);
+}
+
+void BVH::report(const char* name) const {
+    printf("%s: %u prims, %u nodes, %u leaves (max %u prims), depth %u, sah cost %.2f, built in %.2fms\n",
+            name, stats.primitives, stats.nodes, stats.leaves, stats.maxLeafSize, stats.maxDepth,
+            stats.sahCost, stats.buildMs);
+}
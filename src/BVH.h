@@ -0,0 +1,83 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "util.h"
+
+// One node of the flattened hierarchy, laid out to match the std430
+// BVHNode struct in raytrace.comp. Interior nodes store their left child
+// in leftFirst (the right child always follows it); leaves store the
+// first entry of their primitive range and a non-zero count.
+struct BVHNode {
+    alignas(16) glm::vec3 min;
+    i32 leftFirst;
+    alignas(16) glm::vec3 max;
+    i32 count;
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode must match the std430 layout in raytrace.comp");
+
+struct Bounds {
+    glm::vec3 min = glm::vec3(1e30f), max = glm::vec3(-1e30f);
+
+    Bounds() = default;
+    Bounds(const glm::vec3& min, const glm::vec3& max)
+        : min(min), max(max)
+    {}
+
+    void grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+    void grow(const Bounds& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    float area() const {
+        glm::vec3 e = max - min;
+        return e.x < 0 ? 0 : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+class BVH {
+public:
+    // Traversal keeps one far child per level on a fixed-size stack, so the
+    // builder never goes deeper than this.
+    static const u32 MAX_DEPTH = 32;
+    // Entries of that stack, in the CPU tracer and as BVH_STACK_SIZE in
+    // raytrace.comp: one per level, plus one for the node World joins above
+    // the merged meshes' root and the instances' top level.
+    static const u32 STACK_SIZE = MAX_DEPTH + 1;
+    static const u32 MAX_LEAF_SIZE = 8;
+    static const u32 BIN_COUNT = 16;
+
+    struct Stats {
+        u32 primitives = 0;
+        u32 nodes = 0;
+        u32 leaves = 0;
+        u32 maxDepth = 0;
+        u32 maxLeafSize = 0;
+        f32 sahCost = 0;
+        f64 buildMs = 0;
+    };
+
+    std::vector<BVHNode> nodes;
+    // Primitive ids in leaf order; a leaf covers indices[leftFirst, leftFirst + count).
+    std::vector<u32> indices;
+    Stats stats;
+
+    // Binned SAH build over one bounding box per primitive. Nodes of more
+    // than `maxLeafSize` primitives are split, except at MAX_DEPTH and
+    // when all their centroids coincide, which leaves larger leaves.
+    void build(const std::vector<Bounds>& primBounds, u32 maxLeafSize = MAX_LEAF_SIZE);
+    void clear();
+
+    // Prints the build time and quality figures of the last build.
+    void report(const char* name) const;
+
+private:
+    // Bounds, centroid and id of one primitive; partitioned in place so
+    // every node reads its primitives sequentially.
+    struct BuildPrim;
+
+    void subdivide(u32 nodeIdx, u32 depth, u32 maxLeafSize, std::vector<BuildPrim>& prims);
+};
+
+#endif
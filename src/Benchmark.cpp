@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+#include "Scenes.h"
+#include <cmath>
+#include <cstdio>
+
+const BenchCase benchCases[] = {
+    { "scene1", { 480, 270 }, 5, 4, 8 },
+    { "scene2", { 480, 270 }, 5, 4, 8 },
+    { "scene3", { 480, 270 }, 5, 4, 8 },
+    { "roughnessMetallic", { 480, 270 }, 5, 4, 8 },
+    { "boxGrid", { 480, 270 }, 5, 4, 8 },
+    { "meshTest", { 480, 270 }, 5, 4, 8 },
+    { "instanceGrid", { 480, 270 }, 5, 4, 8 },
+    // Per-pixel costs at a size where dispatch overhead is small.
+    { "scene1", { 960, 540 }, 5, 4, 4 },
+    { "scene3", { 960, 540 }, 5, 4, 4 },
+};
+
+const u32 benchCaseCount = sizeof(benchCases) / sizeof(BenchCase);
+
+bool loadBenchCase(World* world, const BenchCase& bench) {
+    world->cam.pos = glm::vec3(0);
+    world->cam.forward = glm::vec3(0, 0, 1);
+    if (!loadScene(world, bench.scene)) {
+        return false;
+    }
+    world->cam.bounces = bench.bounces;
+    world->cam.rayPerPixel = bench.rayPerPixel;
+    world->cam.lightSampling = true;
+    return true;
+}
+
+u64 benchSamplesPerFrame(const BenchCase& bench) {
+    u64 ssq = (u64)std::sqrt((f32)bench.rayPerPixel);
+    return (u64)bench.resolution.x * bench.resolution.y * ssq * ssq;
+}
+
+bool writeBenchReport(const std::string& path, const std::string& backend, const std::string& device,
+        const std::vector<BenchResult>& results) {
+    for (const BenchResult& result : results) {
+        const f64 seconds = result.totalMs / 1000.0;
+        printf("%-18s %4dx%-4d %7.2fms/frame %8.3f Msamples/s %8.3f Mrays/s\n", result.bench.scene,
+                result.bench.resolution.x, result.bench.resolution.y, result.totalMs / result.bench.frames,
+                result.samples / seconds * 1e-6, result.rays / seconds * 1e-6);
+    }
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    // Scene names and device strings are plain ASCII without quotes.
+    fprintf(file, "{\n  \"backend\": \"%s\",\n  \"device\": \"%s\",\n  \"results\": [\n",
+            backend.c_str(), device.c_str());
+    for (u32 i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        const f64 seconds = result.totalMs / 1000.0;
+        fprintf(file, "    { \"scene\": \"%s\", \"width\": %d, \"height\": %d, \"bounces\": %d, "
+                "\"rayPerPixel\": %d, \"frames\": %u, \"msPerFrame\": %.3f, \"samples\": %llu, "
+                "\"rays\": %llu, \"samplesPerSec\": %.0f, \"raysPerSec\": %.0f }%s\n",
+                result.bench.scene, result.bench.resolution.x, result.bench.resolution.y,
+                result.bench.bounces, result.bench.rayPerPixel, result.bench.frames,
+                result.totalMs / result.bench.frames, (unsigned long long)result.samples,
+                (unsigned long long)result.rays, result.samples / seconds, result.rays / seconds,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,43 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "util.h"
+#include "World.h"
+
+// One fixed workload of the benchmark. Both backends render the same
+// cases so their results can be compared directly.
+struct BenchCase {
+    const char* scene;
+    glm::ivec2 resolution;
+    i32 bounces;
+    i32 rayPerPixel;
+    u32 frames;
+};
+
+extern const BenchCase benchCases[];
+extern const u32 benchCaseCount;
+
+struct BenchResult {
+    BenchCase bench;
+    f64 totalMs = 0;
+    u64 samples = 0;
+    // Closest-hit and shadow rays, i.e. hierarchy traversals.
+    u64 rays = 0;
+};
+
+// Loads the case's scene into an empty world and applies its settings.
+bool loadBenchCase(World* world, const BenchCase& bench);
+
+// Camera samples per frame, the same rounding of rayPerPixel to a square
+// grid as the tracers.
+u64 benchSamplesPerFrame(const BenchCase& bench);
+
+// Prints one line per result and writes them as JSON to `path`. Stdout
+// carries the logs of the run, so the report never goes there.
+bool writeBenchReport(const std::string& path, const std::string& backend, const std::string& device,
+        const std::vector<BenchResult>& results);
+
+#endif
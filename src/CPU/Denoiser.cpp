@@ -0,0 +1,72 @@
+#include "Denoiser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace cpu {
+    static const f32 KERNEL[3] = { 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+    static inline glm::vec3 compress(const glm::vec3& color) {
+        return color / (1.0f + glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)));
+    }
+
+    static void denoisePass(const DenoiseParams& params, i32 stepWidth, f32 sigmaColor, i32 width, i32 height,
+            const glm::vec4* input, const glm::vec4* albedo, const glm::vec4* normalDepth, glm::vec4* output) {
+        const f32 rSigmaColor2 = 1.0f / (sigmaColor * sigmaColor);
+        const f32 rSigmaAlbedo2 = 1.0f / (params.sigmaAlbedo * params.sigmaAlbedo);
+        for (i32 y = 0; y < height; ++y) {
+            for (i32 x = 0; x < width; ++x) {
+                const size_t p = (size_t)y * width + x;
+                const glm::vec3 centerColor = compress(glm::vec3(input[p]));
+                const glm::vec4& centerNormalDepth = normalDepth[p];
+
+                glm::vec3 sum(0.0f);
+                f32 weights = 0.0f;
+                for (i32 dy = -2; dy <= 2; ++dy) {
+                    for (i32 dx = -2; dx <= 2; ++dx) {
+                        const i32 qx = x + dx * stepWidth, qy = y + dy * stepWidth;
+                        if (qx < 0 || qy < 0 || qx >= width || qy >= height) {
+                            continue;
+                        }
+                        const size_t q = (size_t)qy * width + qx;
+                        if ((centerNormalDepth.w == 0.0f) != (normalDepth[q].w == 0.0f)) {
+                            continue;
+                        }
+
+                        const glm::vec3 color(input[q]);
+                        const glm::vec3 dc = centerColor - compress(color);
+                        f32 exponent = glm::dot(dc, dc) * rSigmaColor2;
+                        f32 w = KERNEL[std::abs(dx)] * KERNEL[std::abs(dy)];
+                        if (centerNormalDepth.w > 0.0f) {
+                            const glm::vec3 da = glm::vec3(albedo[p]) - glm::vec3(albedo[q]);
+                            const f32 offset = stepWidth * std::sqrt((f32)(dx * dx + dy * dy));
+                            exponent += std::abs(centerNormalDepth.w - normalDepth[q].w) /
+                                    (params.sigmaDepth * centerNormalDepth.w * offset + 1e-6f);
+                            exponent += glm::dot(da, da) * rSigmaAlbedo2;
+                            w *= std::pow(std::max(glm::dot(glm::vec3(centerNormalDepth), glm::vec3(normalDepth[q])), 0.0f),
+                                    params.sigmaNormal);
+                        }
+                        w *= std::exp(-exponent);
+                        sum += color * w;
+                        weights += w;
+                    }
+                }
+                output[p] = glm::vec4(sum / weights, input[p].w);
+            }
+        }
+    }
+
+    void denoise(const DenoiseParams& params, i32 width, i32 height, const glm::vec4* color,
+            const glm::vec4* albedo, const glm::vec4* normalDepth, std::vector<glm::vec4>& out) {
+        const size_t count = (size_t)width * height;
+        out.assign(color, color + count);
+        std::vector<glm::vec4> input;
+        for (i32 pass = 0; pass < params.iterations; ++pass) {
+            input.swap(out);
+            out.resize(count);
+            denoisePass(params, 1 << pass, params.sigmaColor / (f32)(1 << pass), width, height,
+                    input.data(), albedo, normalDepth, out.data());
+        }
+    }
+
+}
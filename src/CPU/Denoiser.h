@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+#include "../Denoiser.h"
+
+namespace cpu {
+    // Reference implementation of shaders/denoise.comp: runs every pass of
+    // the à-trous filter over `color` (width * height pixels, bottom row
+    // first like the GPU images) into `out`, guided by the first-hit albedo
+    // and normal/distance buffers.
+    void denoise(const DenoiseParams& params, i32 width, i32 height, const glm::vec4* color,
+            const glm::vec4* albedo, const glm::vec4* normalDepth, std::vector<glm::vec4>& out);
+
+}
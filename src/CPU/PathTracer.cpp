@@ -0,0 +1,795 @@
+#include "PathTracer.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+namespace cpu {
+    static const u32 TILE_SIZE = 16;
+
+    static const f32 PI = 3.1415926f;
+    static const f32 INV_PI = 1.0f / PI;
+    static const f32 RAD = PI / 180.0f;
+    static const f32 NO_HIT = (f32)0xffffff;
+    static const f32 NO_BOUNDS = 1e30f;
+    static const f32 SPECULAR_DELTA_ROUGHNESS = 0.18f;
+
+    struct Ray {
+        glm::vec3 origin, direction;
+        Ray(const glm::vec3& origin, const glm::vec3& direction)
+            : origin(origin), direction(glm::normalize(direction))
+        {}
+
+        glm::vec3 at(f32 t) const { return origin + t * direction; }
+    };
+
+    struct HitInfo {
+        glm::vec3 point, normal;
+        f32 t;
+        i32 matId;
+        i32 primRef;
+    };
+
+    static inline u32 pcg(u32 v) {
+        u32 state = v * 747796405u + 2891336453u;
+        u32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    static inline u32 hashSeed(u32 pixelX, u32 pixelY, u32 frameIndex, u32 sampleIndex) {
+        u32 h = (pixelX * 73856093u) ^ (pixelY * 19349663u) ^ (frameIndex * 83492791u) ^ (sampleIndex * 2654435761u);
+        return pcg(h);
+    }
+
+    static inline f32 randFloat(u32& seed) {
+        seed = pcg(seed);
+        return (f32)seed / 4294967296.0f;
+    }
+
+    static inline glm::vec3 reflect(const glm::vec3& v, const glm::vec3& n) {
+        return v - glm::dot(v, n) * n * 2.0f;
+    }
+
+    static bool hitSphere(const Sphere& cir, const Ray& r, f32 max, HitInfo& info) {
+        glm::vec3 dir = cir.center - r.origin;
+        f32 a = glm::dot(r.direction, r.direction);
+        f32 b = -2.0f * glm::dot(r.direction, dir);
+        f32 c = glm::dot(dir, dir) - cir.radius * cir.radius;
+        f32 discriminant = b * b - 4 * a * c;
+        if (discriminant < 0) {
+            return false;
+        }
+
+        f32 sqrtd = std::sqrt(discriminant);
+        info.t = (-b - sqrtd) / (2.0f * a);
+
+        if (!(info.t > 1e-3f && info.t < max)) {
+            info.t = (-b + sqrtd) / (2.0f * a);
+            if (!(info.t > 0 && info.t < max)) {
+                return false;
+            }
+        }
+
+        info.point = r.at(info.t);
+        info.normal = (info.point - cir.center) / cir.radius;
+        if (glm::dot(r.direction, info.normal) > 0) {
+            info.normal = -info.normal;
+        }
+        return true;
+    }
+
+    static bool hitQuad(const Quad& quad, const Ray& r, f32 max, HitInfo& info) {
+        glm::vec3 normal = glm::cross(quad.u, quad.v);
+        f32 denom = glm::dot(normal, r.direction);
+        f32 nn = glm::dot(normal, normal);
+
+        if (std::abs(denom) < 1e-8f) return false;
+
+        f32 t = glm::dot(normal, quad.q - r.origin) / denom;
+        if (t <= 1e-3f || t >= max) return false;
+
+        glm::vec3 hitPos = r.at(t);
+        glm::vec3 rel = hitPos - quad.q;
+
+        f32 alpha = glm::dot(normal, glm::cross(rel, quad.v)) / nn;
+        f32 beta  = glm::dot(normal, glm::cross(quad.u, rel)) / nn;
+
+        if (alpha < 0.0f || alpha > 1.0f || beta < 0.0f || beta > 1.0f) return false;
+
+        info.t = t;
+        info.point = hitPos;
+        info.normal = denom < 0.0f ? glm::normalize(normal) : -glm::normalize(normal);
+        return true;
+    }
+
+    static inline glm::vec3 meshPosition(const World& world, u32 i) {
+        const f32* p = &world.getMeshPositions()[i * 3];
+        return glm::vec3(p[0], p[1], p[2]);
+    }
+
+    // Mirrors unpackSnorm2x16 followed by the octahedral decode in the kernel.
+    static inline glm::vec3 meshNormal(const World& world, u32 i) {
+        const u32 packed = world.getMeshNormals()[i];
+        glm::vec2 e(glm::clamp((f32)(i16)(packed & 0xffff) / 32767.0f, -1.0f, 1.0f),
+                    glm::clamp((f32)(i16)(packed >> 16) / 32767.0f, -1.0f, 1.0f));
+        glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        if (n.z < 0.0f) {
+            n.x = (1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+            n.y = (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return glm::normalize(n);
+    }
+
+    static bool hitTriangle(const World& world, const glm::uvec4& tri, const Ray& r, f32 max, HitInfo& info) {
+        const glm::vec3 p0 = meshPosition(world, tri.x);
+        const glm::vec3 e1 = meshPosition(world, tri.y) - p0;
+        const glm::vec3 e2 = meshPosition(world, tri.z) - p0;
+
+        const glm::vec3 p = glm::cross(r.direction, e2);
+        const f32 det = glm::dot(e1, p);
+        if (std::abs(det) < 1e-12f) return false;
+        const f32 invDet = 1.0f / det;
+
+        const glm::vec3 s = r.origin - p0;
+        const f32 u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+
+        const glm::vec3 q = glm::cross(s, e1);
+        const f32 v = glm::dot(r.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+
+        const f32 t = glm::dot(e2, q) * invDet;
+        if (t <= 1e-3f || t >= max) return false;
+
+        info.t = t;
+        info.point = r.at(t);
+
+        glm::vec3 geometric = glm::cross(e1, e2);
+        glm::vec3 normal = (1.0f - u - v) * meshNormal(world, tri.x) + u * meshNormal(world, tri.y)
+                         + v * meshNormal(world, tri.z);
+        if (glm::dot(geometric, r.direction) > 0.0f) {
+            geometric = -geometric;
+        }
+        info.normal = glm::dot(normal, geometric) < 0.0f ? -normal : normal;
+        info.matId = (i32)tri.w;
+        info.primRef = -1;
+        return true;
+    }
+
+    static inline f32 hitBounds(const BVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, f32 closest) {
+        glm::vec3 t0 = (node.min - origin) * invDir;
+        glm::vec3 t1 = (node.max - origin) * invDir;
+        glm::vec3 tmin = glm::min(t0, t1);
+        glm::vec3 tmax = glm::max(t0, t1);
+        f32 tnear = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+        f32 tfar = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, closest));
+        return tnear <= tfar ? tnear : NO_BOUNDS;
+    }
+
+    static inline void hitPrimitive(const World& world, i32 ref, const Ray& r, f32& closest, HitInfo& track) {
+        HitInfo tmp;
+        tmp.primRef = ref;
+        u32 index = ref >> 1;
+
+        if ((ref & 1) == World::PRIMITIVE_SPHERE) {
+            const Sphere& sphere = world.getSpheres()[index];
+            tmp.matId = sphere.materialIndex;
+            if (hitSphere(sphere, r, closest, tmp)) {
+                closest = tmp.t;
+                track = tmp;
+            }
+            return;
+        }
+
+        const Quad& quad = world.getQuads()[index];
+        tmp.matId = quad.materialIndex;
+        if (glm::dot(r.direction, glm::cross(quad.u, quad.v)) > 0)
+            return;
+
+        if (hitQuad(quad, r, closest, tmp)) {
+            closest = tmp.t;
+            track = tmp;
+        }
+    }
+
+    static void traversePrimitives(const World& world, const Ray& r, f32& closest, HitInfo& track) {
+        const std::vector<BVHNode>& nodes = world.getBVH().nodes;
+        const std::vector<i32>& prims = world.getPrimitiveRefs();
+        const glm::vec3 invDir = 1.0f / r.direction;
+
+        if (nodes.empty() || hitBounds(nodes[0], r.origin, invDir, closest) == NO_BOUNDS) {
+            return;
+        }
+
+        u32 stack[BVH::STACK_SIZE];
+        u32 sp = 0;
+        u32 nodeIndex = 0;
+
+        for (;;) {
+            const BVHNode& node = nodes[nodeIndex];
+
+            if (node.count > 0) {
+                for (i32 i = 0; i < node.count; ++i) {
+                    hitPrimitive(world, prims[node.leftFirst + i], r, closest, track);
+                }
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            u32 nearChild = node.leftFirst;
+            u32 farChild = node.leftFirst + 1;
+            f32 dNear = hitBounds(nodes[nearChild], r.origin, invDir, closest);
+            f32 dFar = hitBounds(nodes[farChild], r.origin, invDir, closest);
+            if (dNear > dFar) {
+                std::swap(dNear, dFar);
+                std::swap(nearChild, farChild);
+            }
+
+            if (dNear == NO_BOUNDS) {
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            nodeIndex = nearChild;
+            if (dFar != NO_BOUNDS) {
+                stack[sp++] = farChild;
+            }
+        }
+    }
+
+    // traverseTriangles() over the bottom level of one shape, from `root`.
+    static void traverseShape(const World& world, const Ray& r, u32 root, f32& closest, HitInfo& track) {
+        const ArrayView<BVHNode> nodes = world.getMeshNodes();
+        const ArrayView<glm::uvec4> triangles = world.getMeshTriangles();
+        const glm::vec3 invDir = 1.0f / r.direction;
+
+        if (hitBounds(nodes[root], r.origin, invDir, closest) == NO_BOUNDS) {
+            return;
+        }
+
+        u32 stack[BVH::STACK_SIZE];
+        u32 sp = 0;
+        u32 nodeIndex = root;
+
+        for (;;) {
+            const BVHNode& node = nodes[nodeIndex];
+
+            if (node.count > 0) {
+                for (i32 i = 0; i < node.count; ++i) {
+                    HitInfo tmp;
+                    if (hitTriangle(world, triangles[node.leftFirst + i], r, closest, tmp)) {
+                        closest = tmp.t;
+                        track = tmp;
+                    }
+                }
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            u32 nearChild = node.leftFirst;
+            u32 farChild = node.leftFirst + 1;
+            f32 dNear = hitBounds(nodes[nearChild], r.origin, invDir, closest);
+            f32 dFar = hitBounds(nodes[farChild], r.origin, invDir, closest);
+            if (dNear > dFar) {
+                std::swap(dNear, dFar);
+                std::swap(nearChild, farChild);
+            }
+
+            if (dNear == NO_BOUNDS) {
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            nodeIndex = nearChild;
+            if (dFar != NO_BOUNDS) {
+                stack[sp++] = farChild;
+            }
+        }
+    }
+
+    // Mirrors hitInstance() in the kernel: the ray goes into object space
+    // unnormalized, so t stays the world ray's.
+    static void hitInstance(const World& world, u32 record, const Ray& r, f32& closest, HitInfo& track) {
+        InstanceRecord inst;
+        memcpy((void*)&inst, &world.getMeshTriangles()[record], sizeof(inst));
+        const glm::vec4* rows = inst.worldToObject;
+
+        Ray local = r;
+        local.origin = glm::vec3(glm::dot(rows[0], glm::vec4(r.origin, 1.0f)), glm::dot(rows[1], glm::vec4(r.origin, 1.0f)),
+                                 glm::dot(rows[2], glm::vec4(r.origin, 1.0f)));
+        local.direction = glm::vec3(glm::dot(glm::vec3(rows[0]), r.direction), glm::dot(glm::vec3(rows[1]), r.direction),
+                                    glm::dot(glm::vec3(rows[2]), r.direction));
+
+        const f32 before = closest;
+        traverseShape(world, local, inst.root, closest, track);
+        if (closest < before) {
+            track.point = r.at(closest);
+            track.normal = glm::normalize(track.normal.x * glm::vec3(rows[0]) + track.normal.y * glm::vec3(rows[1])
+                                        + track.normal.z * glm::vec3(rows[2]));
+            track.matId = (i32)inst.material;
+        }
+    }
+
+    static void traverseTriangles(const World& world, const Ray& r, f32& closest, HitInfo& track) {
+        const ArrayView<BVHNode> nodes = world.getMeshNodes();
+        const ArrayView<glm::uvec4> triangles = world.getMeshTriangles();
+        const glm::vec3 invDir = 1.0f / r.direction;
+
+        if (nodes.empty() || hitBounds(nodes[0], r.origin, invDir, closest) == NO_BOUNDS) {
+            return;
+        }
+
+        u32 stack[BVH::STACK_SIZE];
+        u32 sp = 0;
+        u32 nodeIndex = 0;
+
+        for (;;) {
+            const BVHNode& node = nodes[nodeIndex];
+
+            if (node.count != 0) {
+                // Top-level leaves: -count instance records.
+                for (i32 i = 0; i < -node.count; ++i) {
+                    hitInstance(world, node.leftFirst + i * 4, r, closest, track);
+                }
+                for (i32 i = 0; i < node.count; ++i) {
+                    HitInfo tmp;
+                    if (hitTriangle(world, triangles[node.leftFirst + i], r, closest, tmp)) {
+                        closest = tmp.t;
+                        track = tmp;
+                    }
+                }
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            u32 nearChild = node.leftFirst;
+            u32 farChild = node.leftFirst + 1;
+            f32 dNear = hitBounds(nodes[nearChild], r.origin, invDir, closest);
+            f32 dFar = hitBounds(nodes[farChild], r.origin, invDir, closest);
+            if (dNear > dFar) {
+                std::swap(dNear, dFar);
+                std::swap(nearChild, farChild);
+            }
+
+            if (dNear == NO_BOUNDS) {
+                if (sp == 0) break;
+                nodeIndex = stack[--sp];
+                continue;
+            }
+
+            nodeIndex = nearChild;
+            if (dFar != NO_BOUNDS) {
+                stack[sp++] = farChild;
+            }
+        }
+    }
+
+    // Finds the closest hit nearer than `closest`, which is updated in place.
+    static void traverse(const World& world, const Ray& r, f32& closest, HitInfo& track) {
+        traversePrimitives(world, r, closest, track);
+        traverseTriangles(world, r, closest, track);
+    }
+
+    // Both ray queries add one to `rays`, the count the benchmark reports.
+    static void hit(const World& world, const Ray& r, HitInfo& track, u64& rays) {
+        ++rays;
+        f32 closest = NO_HIT;
+        traverse(world, r, closest, track);
+        track.t = closest;
+    }
+
+    static bool occluded(const World& world, const Ray& r, f32 maxT, u64& rays) {
+        ++rays;
+        HitInfo tmp;
+        f32 closest = maxT;
+        traverse(world, r, closest, tmp);
+        return closest < maxT;
+    }
+
+    static inline glm::vec3 perpendicular(const glm::vec3& v) {
+        return (std::abs(v.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+    }
+
+    static glm::vec3 sampleHemisphereCosine(const glm::vec3& N, u32& seed) {
+        f32 r1 = randFloat(seed);
+        f32 r2 = randFloat(seed);
+
+        f32 phi = 2.0f * PI * r1;
+        f32 cosTheta = std::sqrt(1.0f - r2);
+        f32 sinTheta = std::sqrt(r2);
+
+        glm::vec3 T = glm::normalize(glm::cross(N, perpendicular(N)));
+        glm::vec3 B = glm::normalize(glm::cross(N, T));
+        return T * (std::cos(phi) * sinTheta) + B * (std::sin(phi) * sinTheta) + N * cosTheta;
+    }
+
+    static inline glm::vec3 computeF0(const Material& mat) {
+        f32 specular = glm::clamp(mat.specular, 0.0f, 1.0f);
+        glm::vec3 f0 = glm::vec3(0.16f * specular * specular);
+        return glm::mix(f0, mat.albedo, mat.metallic);
+    }
+
+    static inline glm::vec3 fresnelSchlick(f32 cosTheta, const glm::vec3& F0) {
+        return F0 + (glm::vec3(1.0f) - F0) * std::pow(1.0f - cosTheta, 5.0f);
+    }
+
+    static inline f32 NDF_GGX(f32 NoH, f32 roughness) {
+        f32 a = roughness * roughness;
+        f32 a2 = a * a;
+        f32 demon = NoH * NoH * (a2 - 1.0f) + 1.0f;
+        f32 demon2 = demon * demon;
+        return demon2 < 1e-6f ? 1.0f : a2 / demon2 * INV_PI;
+    }
+
+    static inline f32 geometrySchlickGGX(f32 NoV, f32 roughness) {
+        f32 a = roughness * roughness;
+        f32 k = a * 0.5f;
+        return NoV / std::max(NoV * (1.0f - k) + k, 1e-5f);
+    }
+
+    static inline f32 geometrySmith(f32 NoV, f32 NoL, f32 roughness) {
+        return geometrySchlickGGX(NoV, roughness) * geometrySchlickGGX(NoL, roughness);
+    }
+
+    static glm::vec3 sampleGGXVNDF(const glm::vec3& N, const glm::vec3& V, f32 roughness, u32& seed) {
+        f32 a = roughness * roughness;
+
+        f32 r1 = randFloat(seed);
+        f32 r2 = randFloat(seed);
+
+        f32 phi = 2.0f * PI * r1;
+        f32 cosTheta = std::sqrt((1.0f - r2) / (1.0f + (a * a - 1.0f) * r2));
+        f32 sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+        glm::vec3 T = glm::normalize(glm::cross(N, perpendicular(N)));
+        glm::vec3 B = glm::normalize(glm::cross(N, T));
+        glm::vec3 H = T * (std::cos(phi) * sinTheta) + B * (std::sin(phi) * sinTheta) + N * cosTheta;
+
+        glm::vec3 L = reflect(-V, H);
+        return glm::dot(N, L) > 0.0f ? L : glm::vec3(0.0f);
+    }
+
+    static inline f32 specularPdf(f32 NoH, f32 VoH, f32 roughness) {
+        return NDF_GGX(NoH, roughness) * NoH / std::max(4.0f * VoH, 1e-5f);
+    }
+
+    static inline glm::vec3 shadeSpecular(const Material& mat, f32 NoV, f32 NoL, f32 NoH, f32 VoH) {
+        glm::vec3 F = fresnelSchlick(VoH, computeF0(mat));
+        f32 D = NDF_GGX(NoH, mat.roughness);
+        f32 G = geometrySmith(NoV, NoL, mat.roughness);
+        return (D * G * F) / std::max(4.0f * NoV * NoL, 1e-5f);
+    }
+
+    static inline glm::vec3 shadeDiffuse(const Material& mat, f32 VoH) {
+        glm::vec3 F = fresnelSchlick(VoH, computeF0(mat));
+        glm::vec3 kd = (glm::vec3(1.0f) - F) * (1.0f - mat.metallic);
+        return kd * mat.albedo * INV_PI;
+    }
+
+    static inline glm::vec3 shadeSubsurface(const Material& mat, f32 NoL, f32 NoV, f32 LoV) {
+        f32 FL = std::pow(1.0f - NoL, 5.0f);
+        f32 FV = std::pow(1.0f - NoV, 5.0f);
+        f32 Fd90 = 0.5f + 2.0f * LoV * mat.roughness;
+        f32 Fd = glm::mix(1.0f, Fd90, FL) * glm::mix(1.0f, Fd90, FV);
+        return mat.albedo * Fd * INV_PI * mat.subsurface;
+    }
+
+    static f32 quadLightPdf(const Quad& quad, const glm::vec3& origin, const glm::vec3& point) {
+        glm::vec3 n = glm::cross(quad.u, quad.v);
+        f32 area = glm::length(n);
+        glm::vec3 d = point - origin;
+        f32 dist2 = glm::dot(d, d);
+        f32 cosLight = -glm::dot(n, d) / (area * std::sqrt(dist2));
+        return cosLight > 1e-6f ? dist2 / (cosLight * area) : 0.0f;
+    }
+
+    static f32 sphereLightPdf(const Sphere& sphere, const glm::vec3& origin) {
+        glm::vec3 d = sphere.center - origin;
+        f32 dist2 = glm::dot(d, d);
+        f32 r2 = sphere.radius * sphere.radius;
+        if (dist2 <= r2) {
+            return 0.0f;
+        }
+        f32 cosMax = std::sqrt(1.0f - r2 / dist2);
+        return 1.0f / (2.0f * PI * (1.0f - cosMax));
+    }
+
+    static f32 lightPdf(const World& world, i32 ref, const glm::vec3& origin, const glm::vec3& point) {
+        u32 index = ref >> 1;
+        f32 pdf = (ref & 1) == World::PRIMITIVE_QUAD ? quadLightPdf(world.getQuads()[index], origin, point)
+                                                     : sphereLightPdf(world.getSpheres()[index], origin);
+        return pdf / (f32)world.getLights().size();
+    }
+
+    static bool sampleLight(const World& world, const glm::vec3& origin, u32& seed,
+                            glm::vec3& L, f32& dist, f32& pdf, i32& matId) {
+        const std::vector<i32>& lights = world.getLights();
+        const i32 count = (i32)lights.size();
+        i32 ref = lights[std::min((i32)(randFloat(seed) * (f32)count), count - 1)];
+        u32 index = ref >> 1;
+
+        if ((ref & 1) == World::PRIMITIVE_QUAD) {
+            const Quad& quad = world.getQuads()[index];
+            f32 s = randFloat(seed);
+            f32 t = randFloat(seed);
+            glm::vec3 p = quad.q + s * quad.u + t * quad.v;
+            glm::vec3 d = p - origin;
+            dist = glm::length(d);
+            L = d / dist;
+            pdf = quadLightPdf(quad, origin, p) / (f32)count;
+            matId = quad.materialIndex;
+            return pdf > 0.0f;
+        }
+
+        const Sphere& sphere = world.getSpheres()[index];
+        glm::vec3 d = sphere.center - origin;
+        f32 dist2 = glm::dot(d, d);
+        f32 r2 = sphere.radius * sphere.radius;
+        if (dist2 <= r2) {
+            return false;
+        }
+
+        f32 cosMax = std::sqrt(1.0f - r2 / dist2);
+        f32 cosTheta = 1.0f - randFloat(seed) * (1.0f - cosMax);
+        f32 sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        f32 phi = 2.0f * PI * randFloat(seed);
+
+        glm::vec3 W = d / std::sqrt(dist2);
+        glm::vec3 T = glm::normalize(glm::cross(W, perpendicular(W)));
+        glm::vec3 B = glm::cross(W, T);
+        L = T * (std::cos(phi) * sinTheta) + B * (std::sin(phi) * sinTheta) + W * cosTheta;
+
+        f32 b = glm::dot(L, d);
+        dist = b - std::sqrt(std::max(b * b - (dist2 - r2), 0.0f));
+        pdf = 1.0f / (2.0f * PI * (1.0f - cosMax) * (f32)count);
+        matId = sphere.materialIndex;
+        return true;
+    }
+
+    static inline f32 powerHeuristic(f32 a, f32 b) {
+        f32 a2 = a * a;
+        return a2 / std::max(a2 + b * b, 1e-20f);
+    }
+
+    // `firstHit`, when given, receives the first hit, t == NO_HIT for a miss.
+    static glm::vec3 traceColor(const World& world, Ray r, u32& seed, u64& rays, HitInfo* firstHit) {
+        const std::vector<Material>& mats = world.getMaterials();
+        glm::vec3 incomingLight(0.0f);
+        glm::vec3 rayColor(1.0f);
+
+        const bool sampleLights = world.cam.lightSampling && !world.getLights().empty();
+        f32 prevPdf = 0.0f;
+        bool prevDelta = true;
+
+        if (firstHit) {
+            firstHit->t = NO_HIT;
+        }
+        for (i32 i = 0; i < world.cam.bounces; ++i) {
+            HitInfo info;
+            hit(world, r, info, rays);
+            if (i == 0 && firstHit) {
+                *firstHit = info;
+            }
+
+            if (info.t == NO_HIT) {
+                f32 t = (r.direction.y + 1) * 0.5f;
+                glm::vec3 envColor = (1.0f - t) * glm::vec3(1) + t * world.skyColor;
+                incomingLight += glm::length(world.skyColor) * envColor * rayColor;
+                break;
+            }
+
+            const Material& mat = mats[info.matId];
+            const glm::vec3 N = glm::normalize(info.normal);
+            const glm::vec3 V = glm::normalize(-r.direction);
+
+            if (mat.emissionStrength > 0.0f) {
+                f32 weight = 1.0f;
+                if (sampleLights && !prevDelta && info.primRef >= 0) {
+                    weight = powerHeuristic(prevPdf, lightPdf(world, info.primRef, r.origin, info.point));
+                }
+                incomingLight += rayColor * mat.emissionColor * mat.emissionStrength * weight;
+            }
+
+            f32 subsurfaceProb = mat.subsurface;
+            f32 diffuseProb = 1.0f - mat.metallic;
+            f32 specularProb = 0.5f + 0.5f * mat.metallic;
+
+            f32 totalProb = subsurfaceProb + diffuseProb + specularProb;
+            subsurfaceProb /= totalProb;
+            diffuseProb /= totalProb;
+            specularProb /= totalProb;
+
+            const bool specularDelta = mat.roughness < SPECULAR_DELTA_ROUGHNESS;
+            const f32 NoV = glm::clamp(glm::dot(N, V), 0.0f, 1.0f);
+
+            // The last vertex has no bounce left to reach a light with.
+            if (sampleLights && i + 1 < world.cam.bounces) {
+                glm::vec3 Ls;
+                f32 lightDist, lpdf;
+                i32 lightMat;
+                if (sampleLight(world, info.point, seed, Ls, lightDist, lpdf, lightMat)) {
+                    const f32 NoL = glm::dot(N, Ls);
+                    if (NoL > 0.0f && !occluded(world, Ray(info.point + Ls * 0.0001f, Ls), lightDist * (1.0f - 1e-3f), rays)) {
+                        const Material& light = mats[lightMat];
+                        const glm::vec3 H = glm::normalize(V + Ls);
+                        const f32 NoH = glm::clamp(glm::dot(N, H), 0.0f, 1.0f);
+                        const f32 VoH = glm::clamp(glm::dot(V, H), 0.0f, 1.0f);
+                        const f32 LoV = glm::clamp(glm::dot(Ls, V), 0.0f, 1.0f);
+
+                        const f32 pdf_diff = NoL * INV_PI * diffuseProb;
+                        const f32 pdf_sss = NoL * INV_PI * subsurfaceProb;
+                        glm::vec3 f = shadeDiffuse(mat, VoH) * powerHeuristic(lpdf, pdf_diff)
+                                    + shadeSubsurface(mat, NoL, NoV, LoV) * powerHeuristic(lpdf, pdf_sss);
+                        if (!specularDelta) {
+                            const f32 pdf_spec = specularPdf(NoH, VoH, mat.roughness) * specularProb;
+                            f += shadeSpecular(mat, NoV, NoL, NoH, VoH) * powerHeuristic(lpdf, pdf_spec);
+                        }
+
+                        incomingLight += rayColor * light.emissionColor * light.emissionStrength * f * NoL / lpdf;
+                    }
+                }
+            }
+
+            glm::vec3 L;
+            const f32 Xi = randFloat(seed);
+            f32 pdf_used;
+            i32 lobe;
+            if (Xi <= diffuseProb) {
+                L = sampleHemisphereCosine(N, seed);
+                lobe = 0;
+            } else if (Xi <= diffuseProb + specularProb) {
+                L = sampleGGXVNDF(N, V, mat.roughness, seed);
+                lobe = 1;
+            } else {
+                L = sampleHemisphereCosine(N, seed);
+                lobe = 2;
+            }
+
+            // sampleGGXVNDF() returns a zero vector for directions under the
+            // surface; normalizing it is undefined in GLSL, end the path instead.
+            if (L == glm::vec3(0.0f)) {
+                break;
+            }
+            L = glm::normalize(L);
+
+            const glm::vec3 H = glm::normalize(V + L);
+            const f32 NoL = glm::clamp(glm::dot(N, L), 0.0f, 1.0f);
+            const f32 NoH = glm::clamp(glm::dot(N, H), 0.0f, 1.0f);
+            const f32 VoH = glm::clamp(glm::dot(V, H), 0.0f, 1.0f);
+            const f32 LoV = glm::clamp(glm::dot(L, V), 0.0f, 1.0f);
+
+            // Only the sampled lobe has a non-zero pdf, so the kernel's
+            // pdf-squared weighting reduces to that lobe's BRDF, damped the
+            // same way when the pdf falls under the 1e-5 clamp.
+            glm::vec3 brdf;
+            if (lobe == 0) {
+                brdf = shadeDiffuse(mat, VoH);
+                pdf_used = NoL * INV_PI * diffuseProb;
+            } else if (lobe == 1) {
+                brdf = shadeSpecular(mat, NoV, NoL, NoH, VoH);
+                pdf_used = specularPdf(NoH, VoH, mat.roughness) * specularProb;
+            } else {
+                brdf = shadeSubsurface(mat, NoL, NoV, LoV);
+                pdf_used = NoL * INV_PI * subsurfaceProb;
+            }
+            if (pdf_used * pdf_used < 1e-5f) {
+                brdf *= pdf_used * pdf_used / 1e-5f;
+            }
+
+            const glm::vec3 contribution = (brdf * NoL) / std::max(pdf_used, 1e-5f);
+
+            prevPdf = pdf_used;
+            prevDelta = lobe == 1 && specularDelta;
+            rayColor *= contribution;
+            r = Ray(info.point + L * 0.0001f, L);
+
+            const World::Camera& cam = world.cam;
+            if (cam.roulette && i + 1 >= cam.rouletteDepth && i + 1 < cam.bounces) {
+                const f32 survival = glm::clamp(std::max(rayColor.x, std::max(rayColor.y, rayColor.z)),
+                                                cam.rouletteMinSurvival, 1.0f);
+                if (randFloat(seed) >= survival) {
+                    break;
+                }
+                rayColor /= survival;
+            }
+        }
+
+        return incomingLight;
+    }
+
+    PathTracer::PathTracer(const World& world, i32 width, i32 height, u32 threadCount)
+        : m_world(world), m_pool(threadCount), m_width(0), m_height(0), m_rays(0)
+    {
+        resize(width, height);
+    }
+
+    void PathTracer::resize(i32 width, i32 height) {
+        m_width = width;
+        m_height = height;
+        m_pixels.assign((size_t)width * height, glm::vec4(0));
+        m_albedo.assign((size_t)width * height, glm::vec4(0));
+        m_normalDepth.assign((size_t)width * height, glm::vec4(0));
+    }
+
+    u64 PathTracer::samplesPerFrame() const {
+        u64 ssq = (u64)std::sqrt((f32)m_world.cam.rayPerPixel);
+        return (u64)m_width * m_height * ssq * ssq;
+    }
+
+    void PathTracer::render(u32 frameIndex) {
+        u32 tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+        u32 tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+        m_pool.run(tilesX * tilesY, [this, frameIndex](u32 tile) {
+            renderTile(tile, frameIndex);
+        });
+    }
+
+    void PathTracer::renderTile(u32 tile, u32 frameIndex) {
+        const World::Camera& cam = m_world.cam;
+        u32 tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+        i32 x0 = (tile % tilesX) * TILE_SIZE;
+        i32 y0 = (tile / tilesX) * TILE_SIZE;
+        i32 x1 = std::min(x0 + (i32)TILE_SIZE, m_width);
+        i32 y1 = std::min(y0 + (i32)TILE_SIZE, m_height);
+
+        const glm::vec2 rImgSize = 1.0f / glm::vec2(m_width, m_height);
+        const glm::vec3 lookat = cam.forward + cam.pos;
+        const glm::vec3 cameraCenter = cam.pos;
+
+        const f32 viewportRatio = m_width * rImgSize.y;
+        const f32 focalLength = glm::length(lookat - cameraCenter);
+        const f32 viewportHeight = 2.0f * std::tan(RAD * cam.fov * 0.5f) * focalLength;
+        const f32 viewportWidth = viewportHeight * viewportRatio;
+
+        const i32 ssq = (i32)std::sqrt((f32)cam.rayPerPixel);
+        const f32 rssq = 1.0f / ssq;
+
+        // Counted per tile so threads touch the shared counter once each.
+        u64 rays = 0;
+        for (i32 y = y0; y < y1; ++y) {
+            for (i32 x = x0; x < x1; ++x) {
+                glm::vec2 ndc = glm::vec2(x, y) * rImgSize * 2.0f - 1.0f;
+                glm::vec3 uv = viewportWidth * 0.5f * ndc.x * cam.right
+                             + viewportHeight * 0.5f * ndc.y * cam.up
+                             + focalLength * cam.forward
+                             + cameraCenter;
+
+                glm::vec3 color(0.0f);
+                HitInfo firstHit;
+                firstHit.t = NO_HIT;
+                for (i32 i = 0; i < ssq; ++i) {
+                    for (i32 j = 0; j < ssq; ++j) {
+                        u32 seed = hashSeed(x, y, frameIndex, j + i * ssq);
+                        f32 jx = (j + randFloat(seed)) * rssq;
+                        f32 jy = (i + randFloat(seed)) * rssq;
+                        Ray r(cameraCenter, uv + jx * rImgSize.x * cam.right
+                                               + jy * rImgSize.y * cam.up
+                                               - cameraCenter);
+                        color += traceColor(m_world, r, seed, rays, i == 0 && j == 0 ? &firstHit : nullptr);
+                    }
+                }
+                color *= rssq * rssq;
+
+                // Denoiser guides, as writeGuides() in raytrace.comp.
+                const size_t index = (size_t)y * m_width + x;
+                if (firstHit.t == NO_HIT) {
+                    m_albedo[index] = glm::vec4(0.0f);
+                    m_normalDepth[index] = glm::vec4(0.0f);
+                }
+                else {
+                    m_albedo[index] = glm::vec4(m_world.getMaterials()[firstHit.matId].albedo, 1.0f);
+                    m_normalDepth[index] = glm::vec4(glm::normalize(firstHit.normal), firstHit.t);
+                }
+
+                glm::vec4& pixel = m_pixels[(size_t)y * m_width + x];
+                pixel = (pixel * (f32(frameIndex) - 1.0f) + glm::vec4(color, 1.0f)) / f32(frameIndex);
+            }
+        }
+        m_rays += rays;
+    }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ThreadPool.h"
+#include "../World.h"
+
+namespace cpu {
+    // CPU port of shaders/raytrace.comp. Every frame traces the same
+    // per-pixel estimator as the compute kernel (same seeds, same sampling
+    // and shading) and blends it into a float RGBA accumulation buffer, so
+    // both backends converge to the same image.
+    class PathTracer
+    {
+    private:
+        const World& m_world;
+        ThreadPool m_pool;
+        i32 m_width, m_height;
+        std::vector<glm::vec4> m_pixels;
+        // First-hit guides of the denoiser, see cpu::denoise().
+        std::vector<glm::vec4> m_albedo;
+        std::vector<glm::vec4> m_normalDepth;
+        std::atomic<u64> m_rays;
+
+        void renderTile(u32 tile, u32 frameIndex);
+
+    public:
+        PathTracer(const World& world, i32 width, i32 height, u32 threadCount = 0);
+
+        void resize(i32 width, i32 height);
+        void render(u32 frameIndex);
+
+        inline const std::vector<glm::vec4>& getPixels() const { return m_pixels; }
+        inline const std::vector<glm::vec4>& getAlbedo() const { return m_albedo; }
+        inline const std::vector<glm::vec4>& getNormalDepth() const { return m_normalDepth; }
+        inline i32 width() const { return m_width; }
+        inline i32 height() const { return m_height; }
+        inline u32 threadCount() const { return m_pool.size(); }
+
+        // Camera samples traced by one render() call.
+        u64 samplesPerFrame() const;
+
+        // Closest-hit and shadow rays traced since the last reset.
+        inline u64 raysTraced() const { return m_rays; }
+        inline void resetRayCount() { m_rays = 0; }
+    };
+
+}
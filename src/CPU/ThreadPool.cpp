@@ -0,0 +1,78 @@
+#include "ThreadPool.h"
+
+namespace cpu {
+    ThreadPool::ThreadPool(u32 threadCount)
+        : m_nextJob(0)
+    {
+        if (threadCount == 0) {
+            threadCount = std::thread::hardware_concurrency();
+        }
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+
+        for (u32 i = 1; i < threadCount; ++i) {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::drain() {
+        for (u32 i = m_nextJob++; i < m_jobCount; i = m_nextJob++) {
+            m_job(i);
+        }
+    }
+
+    void ThreadPool::workerLoop() {
+        u64 seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_quit || m_generation != seen; });
+                if (m_quit) {
+                    return;
+                }
+                seen = m_generation;
+                ++m_busy;
+            }
+
+            drain();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_busy;
+            }
+            m_done.notify_one();
+        }
+    }
+
+    void ThreadPool::run(u32 jobCount, const std::function<void(u32)>& job) {
+        {
+            // A worker that woke up late for the previous batch may still be
+            // draining it; never swap the job out from under it.
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [&]() { return m_busy == 0; });
+            m_job = job;
+            m_jobCount = jobCount;
+            m_nextJob = 0;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&]() { return m_busy == 0 && m_nextJob >= m_jobCount; });
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "../util.h"
+
+namespace cpu {
+    class ThreadPool
+    {
+    private:
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake, m_done;
+
+        std::function<void(u32)> m_job;
+        std::atomic<u32> m_nextJob;
+        u32 m_jobCount = 0;
+        u32 m_busy = 0;
+        u64 m_generation = 0;
+        bool m_quit = false;
+
+        void workerLoop();
+        void drain();
+
+    public:
+        // threadCount == 0 picks std::thread::hardware_concurrency().
+        explicit ThreadPool(u32 threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Runs job(0) .. job(jobCount - 1) across the pool (the calling
+        // thread helps) and returns once every job has finished.
+        void run(u32 jobCount, const std::function<void(u32)>& job);
+
+        inline u32 size() const { return (u32)m_workers.size() + 1; }
+    };
+
+}
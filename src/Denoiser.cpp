@@ -0,0 +1,66 @@
+#include "Denoiser.h"
+
+#define SHADER_SOURCE_DIRECTORY "shaders/"
+#define DENOISE_GROUP_SIZE 16
+
+Denoiser::Denoiser()
+    : m_output(nullptr)
+{}
+
+const gl::Image2D& Denoiser::apply(const gl::Image2D& color, const gl::Image2D& albedo, const gl::Image2D& normalDepth,
+        const DenoiseParams& params, gl::GpuProfiler& profiler) {
+    if (params.iterations <= 0) {
+        m_output = &color;
+        return color;
+    }
+
+    if (!m_shader) {
+        m_shader.reset(new gl::ComputeShader(SHADER_SOURCE_DIRECTORY "denoise.comp", glm::vec3(1)));
+        m_stepWidth = m_shader->get_uniform<i32>("stepWidth");
+        m_sigmaColor = m_shader->get_uniform<f32>("sigmaColor");
+        m_sigmaNormal = m_shader->get_uniform<f32>("sigmaNormal");
+        m_sigmaDepth = m_shader->get_uniform<f32>("sigmaDepth");
+        m_sigmaAlbedo = m_shader->get_uniform<f32>("sigmaAlbedo");
+    }
+    for (std::unique_ptr<gl::Image2D>& image : m_images) {
+        if (!image) {
+            image.reset(new gl::Image2D(color.width(), color.height()));
+        }
+        else if (image->width() != color.width() || image->height() != color.height()) {
+            image->resize(color.width(), color.height());
+        }
+    }
+
+    gl::ComputeShader& shader = *m_shader;
+    shader.bind();
+    shader.updateGroups({ (color.width() + DENOISE_GROUP_SIZE - 1) / DENOISE_GROUP_SIZE,
+                          (color.height() + DENOISE_GROUP_SIZE - 1) / DENOISE_GROUP_SIZE, 1 });
+    shader.set(m_sigmaNormal, params.sigmaNormal);
+    shader.set(m_sigmaDepth, params.sigmaDepth);
+    shader.set(m_sigmaAlbedo, params.sigmaAlbedo);
+    albedo.bind(2);
+    normalDepth.bind(3);
+
+    profiler.begin("denoise");
+    const gl::Image2D* input = &color;
+    for (i32 pass = 0; pass < params.iterations; ++pass) {
+        const gl::Image2D* output = m_images[pass & 1].get();
+        shader.set(m_stepWidth, 1 << pass);
+        shader.set(m_sigmaColor, params.sigmaColor / (f32)(1 << pass));
+        input->bind(0);
+        output->bind(1);
+        shader.use();
+        input = output;
+    }
+    profiler.end();
+
+    m_output = input;
+    return *input;
+}
+
+void Denoiser::release() {
+    m_shader.reset();
+    m_images[0].reset();
+    m_images[1].reset();
+    m_output = nullptr;
+}
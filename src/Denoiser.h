@@ -0,0 +1,53 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <memory>
+#include "OpenGL/ComputeShader.h"
+#include "OpenGL/Image2D.h"
+#include "OpenGL/GpuProfiler.h"
+#include "util.h"
+
+// Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010) over the
+// accumulated image, guided by the albedo, normal and hit distance of the
+// first hit that raytrace.comp writes. Each pass blurs with a 5x5 B3-spline
+// kernel whose taps lie 2^pass pixels apart, skipping taps across edges of
+// the guides, so a few passes cover a wide footprint for 25 taps each.
+// cpu::denoise() is the reference implementation of the same filter.
+struct DenoiseParams {
+    i32 iterations = 5;
+    // Width of the colour weight, halved every pass as the noise goes down.
+    f32 sigmaColor = 1.5f;
+    // Exponent of the normal weight, max(dot(n, n'), 0)^sigmaNormal.
+    f32 sigmaNormal = 64;
+    // Allowed hit distance difference relative to the distance, per pixel
+    // of tap offset.
+    f32 sigmaDepth = 0.05f;
+    f32 sigmaAlbedo = 0.1f;
+};
+
+class Denoiser {
+private:
+    std::unique_ptr<gl::ComputeShader> m_shader;
+    gl::Uniform<i32> m_stepWidth;
+    gl::Uniform<f32> m_sigmaColor, m_sigmaNormal, m_sigmaDepth, m_sigmaAlbedo;
+    // Ping-pong targets of the passes.
+    std::unique_ptr<gl::Image2D> m_images[2];
+    const gl::Image2D* m_output;
+
+public:
+    Denoiser();
+
+    // Filters `color` into one of the denoiser's images and returns it, or
+    // `color` itself for zero iterations. The pass time goes to `profiler`
+    // as "denoise".
+    const gl::Image2D& apply(const gl::Image2D& color, const gl::Image2D& albedo, const gl::Image2D& normalDepth,
+            const DenoiseParams& params, gl::GpuProfiler& profiler);
+    // Deletes the program and images; call while the context is current.
+    void release();
+
+    // The image the last apply() returned.
+    inline const gl::Image2D* output() const { return m_output; }
+
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef DIRTY_RANGE_H
+#define DIRTY_RANGE_H
+
+#include <algorithm>
+#include "util.h"
+
+// Union of the elements of an array changed since the last upload. One
+// range per buffer keeps it to a single glBufferSubData per frame; edits
+// far apart upload what lies between them too.
+struct DirtyRange {
+    u32 begin = 0, end = 0;
+
+    bool empty() const { return begin == end; }
+    void clear() { begin = end = 0; }
+
+    void add(u32 first, u32 count = 1) {
+        if (empty()) {
+            begin = first;
+            end = first + count;
+        }
+        else {
+            begin = std::min(begin, first);
+            end = std::max(end, first + count);
+        }
+    }
+};
+
+#endif
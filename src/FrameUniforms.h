@@ -0,0 +1,76 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include "glm/glm.hpp"
+#include "util.h"
+
+// Everything the kernels read per frame, laid out to match the std140
+// Frame block declared in raytrace.comp and screen.frag. The application
+// writes one of these per frame instead of setting single uniforms.
+
+// Bound to uniform block binding 0 in both programs.
+#define FRAME_UNIFORM_BINDING 0
+
+struct CameraUniforms {
+    alignas(16) glm::vec3 position;
+    f32 fov;
+    alignas(16) glm::vec3 forward;
+    i32 bounces;
+    alignas(16) glm::vec3 right;
+    i32 rayPerPixel;
+    alignas(16) glm::vec3 up;
+    i32 lightSampling;
+    i32 roulette;
+    i32 rouletteDepth;
+    f32 rouletteMinSurvival;
+    i32 sampler;
+};
+
+// The camera of the previous dispatch, which raytrace.comp projects the
+// first hits into to find their last frame's radiance after camera motion.
+struct HistoryUniforms {
+    alignas(16) glm::vec3 position;
+    f32 fov;
+    alignas(16) glm::vec3 forward;
+    i32 reproject;
+    alignas(16) glm::vec3 right;
+    i32 maxHistory;
+    alignas(16) glm::vec3 up;
+    f32 depthTolerance;
+};
+
+// Everything but the tiles; screen.frag only declares this part.
+struct FrameParams {
+    CameraUniforms cam;
+    alignas(16) glm::vec3 skyColor;
+    i32 countRays;
+    glm::vec2 resolution;
+    i32 toneMappingMethodIdx;
+    f32 exposure;
+    f32 gamma;
+    f32 adaptiveThreshold;
+    i32 adaptiveMinSamples;
+    i32 sampleHeatmap;
+    HistoryUniforms history;
+    // Sample point of every pixel when rasterPrimary is set, see
+    // PrimaryRaster.h.
+    glm::vec2 primaryJitter;
+    i32 rasterPrimary;
+};
+
+struct FrameUniforms {
+    // Fills the block to the 16 KiB every implementation must support.
+    static const u32 MAX_TILES = 1011;
+
+    FrameParams params;
+    // Tiles traced by this dispatch, one per work group layer: origin in
+    // xy and the sample number (the kernel's frameIndex) in z.
+    glm::ivec4 tiles[MAX_TILES];
+};
+
+static_assert(sizeof(CameraUniforms) == 80, "CameraUniforms must match the std140 layout in raytrace.comp");
+static_assert(sizeof(HistoryUniforms) == 64, "HistoryUniforms must match the std140 layout in raytrace.comp");
+static_assert(sizeof(FrameParams) == 208, "FrameParams must match the std140 layout in raytrace.comp");
+static_assert(sizeof(FrameUniforms) == 16384, "FrameUniforms must fit the minimum uniform block size");
+
+#endif
@@ -0,0 +1,150 @@
+#include "ImageWriter.h"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+bool writePFM(const std::string& path, i32 width, i32 height, const f32* rgba) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    // A negative scale marks little-endian data; PFM scanlines already run
+    // bottom to top, which matches GL's texture origin.
+    fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+
+    std::vector<f32> row((size_t)width * 3);
+    bool ok = true;
+    for (i32 y = 0; y < height && ok; ++y) {
+        const f32* src = rgba + (size_t)y * width * 4;
+        for (i32 x = 0; x < width; ++x) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        ok = fwrite(row.data(), sizeof(f32), row.size(), file) == row.size();
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+static u32 crc32(u32 crc, const u8* data, size_t size) {
+    static u32 table[256];
+    static bool init = false;
+    if (!init) {
+        for (u32 n = 0; n < 256; ++n) {
+            u32 c = n;
+            for (u32 k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        init = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putU32BE(std::vector<u8>& out, u32 v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+static void putChunk(std::vector<u8>& out, const char* type, const std::vector<u8>& data) {
+    putU32BE(out, (u32)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32BE(out, crc32(0, &out[start], out.size() - start));
+}
+
+bool writePNG(const std::string& path, i32 width, i32 height, const u8* rgba) {
+    // Filter type 0 scanlines, top row first.
+    const size_t stride = (size_t)width * 3 + 1;
+    std::vector<u8> raw(stride * height);
+    for (i32 y = 0; y < height; ++y) {
+        const u8* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        u8* dst = &raw[stride * y];
+        dst[0] = 0;
+        for (i32 x = 0; x < width; ++x) {
+            dst[1 + x * 3 + 0] = src[x * 4 + 0];
+            dst[1 + x * 3 + 1] = src[x * 4 + 1];
+            dst[1 + x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    // zlib stream made of stored deflate blocks.
+    std::vector<u8> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t pos = 0;
+    do {
+        u32 len = (u32)std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + len == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(len & 0xff);
+        zlib.push_back(len >> 8);
+        zlib.push_back(~len & 0xff);
+        zlib.push_back((~len >> 8) & 0xff);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+
+    u32 a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32BE(zlib, (b << 16) | a);
+
+    std::vector<u8> header;
+    putU32BE(header, width);
+    putU32BE(header, height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // truecolor
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    static const u8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    std::vector<u8> png(signature, signature + sizeof(signature));
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<u8>());
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && ok;
+}
+
+static bool hasExtension(const std::string& path, const char* ext) {
+    std::string e(ext);
+    return path.size() >= e.size() && path.compare(path.size() - e.size(), e.size(), e) == 0;
+}
+
+bool writeImage(const std::string& path, i32 width, i32 height, const f32* rgba, f32 gamma) {
+    if (hasExtension(path, ".pfm")) {
+        return writePFM(path, width, height, rgba);
+    }
+    if (!hasExtension(path, ".png")) {
+        return false;
+    }
+
+    std::vector<u8> pixels((size_t)width * height * 4);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        f32 v = std::pow(std::max(rgba[i], 0.0f), 1.0f / gamma);
+        pixels[i] = (u8)(std::min(v, 1.0f) * 255.0f + 0.5f);
+    }
+    return writePNG(path, width, height, pixels.data());
+}
@@ -0,0 +1,20 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+#include "util.h"
+
+// All writers take width * height RGBA pixels with rows ordered bottom to
+// top, as read back from GL; alpha is dropped.
+
+// Little-endian Portable Float Map, linear values untouched.
+bool writePFM(const std::string& path, i32 width, i32 height, const f32* rgba);
+
+// 8-bit RGB PNG (stored, uncompressed deflate blocks).
+bool writePNG(const std::string& path, i32 width, i32 height, const u8* rgba);
+
+// Picks the format from the extension (.pfm or .png). PNG output is
+// gamma encoded like screen.frag without a tone mapping operator.
+bool writeImage(const std::string& path, i32 width, i32 height, const f32* rgba, f32 gamma = 2.2f);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include "util.h"
+
+// Read-only memory mapping of a whole file (mmap, or a file mapping on
+// Windows). Pages are read in on first touch.
+class MappedFile {
+private:
+    const u8* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    inline const u8* data() const { return m_data; }
+    inline size_t size() const { return m_size; }
+    inline bool isOpen() const { return m_data != nullptr; }
+};
+
+#endif
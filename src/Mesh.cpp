@@ -0,0 +1,279 @@
+#include "Mesh.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+Bounds Mesh::bounds() const {
+    Bounds b;
+    for (const glm::vec3& p : positions) {
+        b.grow(p);
+    }
+    return b;
+}
+
+void Mesh::computeNormals() {
+    normals.resize(positions.size(), glm::vec3(0.0f));
+
+    std::vector<bool> missing(normals.size());
+    for (u32 i = 0; i < normals.size(); ++i) {
+        missing[i] = normals[i] == glm::vec3(0.0f);
+    }
+
+    // The cross product's length is twice the triangle's area, which gives
+    // larger faces more say in the shared normal.
+    for (u32 i = 0; i + 2 < indices.size(); i += 3) {
+        const u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        const glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        if (missing[a]) normals[a] += n;
+        if (missing[b]) normals[b] += n;
+        if (missing[c]) normals[c] += n;
+    }
+
+    for (u32 i = 0; i < normals.size(); ++i) {
+        if (!missing[i]) {
+            continue;
+        }
+        const f32 len = glm::length(normals[i]);
+        normals[i] = len > 0.0f ? normals[i] / len : glm::vec3(0, 1, 0);
+    }
+}
+
+void Mesh::fit(const glm::vec3& center, f32 size) {
+    const Bounds b = bounds();
+    const glm::vec3 extent = b.max - b.min;
+    const f32 largest = std::max(std::max(extent.x, extent.y), extent.z);
+    const f32 scale = largest > 0.0f ? size / largest : 1.0f;
+    const glm::vec3 origin = b.center();
+    for (glm::vec3& p : positions) {
+        p = (p - origin) * scale + center;
+    }
+}
+
+u32 Mesh::PackNormal(const glm::vec3& n) {
+    glm::vec3 v = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 e(v.x, v.y);
+    if (v.z < 0.0f) {
+        e = glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    const i16 x = (i16)std::lround(glm::clamp(e.x, -1.0f, 1.0f) * 32767.0f);
+    const i16 y = (i16)std::lround(glm::clamp(e.y, -1.0f, 1.0f) * 32767.0f);
+    return (u32)(u16)x | ((u32)(u16)y << 16);
+}
+
+// === OBJ parsing ===
+// Hand-rolled number parsing; strtof and sscanf dominate load time on
+// multi-million triangle files.
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* skipBlank(const char* p) {
+    while (isBlank(*p)) ++p;
+    return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end) {
+    while (p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : p;
+}
+
+static const char* parseFloat(const char* p, f32& out) {
+    static const f64 POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    p = skipBlank(p);
+    const bool negative = *p == '-';
+    if (*p == '-' || *p == '+') ++p;
+
+    u64 mantissa = 0;
+    i32 exponent = 0;
+    i32 digits = 0;
+    for (; isDigit(*p); ++p) {
+        if (digits++ < 19) mantissa = mantissa * 10 + (*p - '0');
+        else ++exponent;
+    }
+    if (*p == '.') {
+        for (++p; isDigit(*p); ++p) {
+            if (digits++ < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
+        }
+    }
+    if (*p == 'e' || *p == 'E') {
+        ++p;
+        const bool negativeExp = *p == '-';
+        if (*p == '-' || *p == '+') ++p;
+        i32 e = 0;
+        for (; isDigit(*p); ++p) {
+            e = std::min(e * 10 + (*p - '0'), 1000);
+        }
+        exponent += negativeExp ? -e : e;
+    }
+
+    f64 value = (f64)mantissa;
+    if (exponent < 0) {
+        value = -exponent <= 22 ? value / POW10[-exponent] : value * std::pow(10.0, exponent);
+    }
+    else if (exponent > 0) {
+        value = exponent <= 22 ? value * POW10[exponent] : value * std::pow(10.0, exponent);
+    }
+    out = (f32)(negative ? -value : value);
+    return p;
+}
+
+static const char* parseInt(const char* p, i64& out) {
+    const bool negative = *p == '-';
+    if (*p == '-' || *p == '+') ++p;
+    i64 value = 0;
+    for (; isDigit(*p); ++p) {
+        value = value * 10 + (*p - '0');
+    }
+    out = negative ? -value : value;
+    return p;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last element.
+static inline bool resolveIndex(i64 index, size_t count, u32& out) {
+    const i64 resolved = index < 0 ? (i64)count + index : index - 1;
+    if (resolved < 0 || resolved >= (i64)count) {
+        return false;
+    }
+    out = (u32)resolved;
+    return true;
+}
+
+static const u32 NO_NORMAL = 0xffffffffu;
+
+bool Mesh::LoadOBJ(const std::string& path, Mesh& mesh) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // Read the file in one go; the parser relies on the trailing '\0'.
+    std::vector<char> data;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return false;
+    }
+    data.resize((size_t)size + 1);
+    const bool ok = fread(data.data(), 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+    data[size] = '\0';
+
+    std::vector<glm::vec3> objPositions, objNormals;
+    // (position, normal) per triangle corner, normal is NO_NORMAL when absent.
+    std::vector<glm::uvec2> corners;
+    std::vector<glm::uvec2> face;
+
+    // Rough guesses from typical line lengths to avoid most regrowth.
+    objPositions.reserve(size / 96);
+    corners.reserve(size / 32);
+
+    const char* p = data.data();
+    const char* end = p + size;
+    while (p < end) {
+        p = skipBlank(p);
+
+        if (p[0] == 'v' && isBlank(p[1])) {
+            glm::vec3 v;
+            p = parseFloat(p + 2, v.x);
+            p = parseFloat(p, v.y);
+            p = parseFloat(p, v.z);
+            objPositions.push_back(v);
+        }
+        else if (p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+            glm::vec3 n;
+            p = parseFloat(p + 3, n.x);
+            p = parseFloat(p, n.y);
+            p = parseFloat(p, n.z);
+            objNormals.push_back(n);
+        }
+        else if (p[0] == 'f' && isBlank(p[1])) {
+            face.clear();
+            p = skipBlank(p + 2);
+            while (*p && *p != '\n' && *p != '#') {
+                i64 index;
+                glm::uvec2 corner(0, NO_NORMAL);
+                p = parseInt(p, index);
+                if (!resolveIndex(index, objPositions.size(), corner.x)) {
+                    return false;
+                }
+                if (*p == '/') {
+                    ++p;
+                    if (*p != '/') {
+                        p = parseInt(p, index); // texture coordinates are not used
+                    }
+                    if (*p == '/') {
+                        p = parseInt(p + 1, index);
+                        if (!resolveIndex(index, objNormals.size(), corner.y)) {
+                            return false;
+                        }
+                    }
+                }
+                face.push_back(corner);
+                p = skipBlank(p);
+            }
+
+            for (u32 i = 2; i < face.size(); ++i) {
+                corners.push_back(face[0]);
+                corners.push_back(face[i - 1]);
+                corners.push_back(face[i]);
+            }
+        }
+
+        p = skipLine(p, end);
+    }
+
+    mesh.positions.clear();
+    mesh.normals.clear();
+    mesh.indices.resize(corners.size());
+
+    if (objNormals.empty()) {
+        // Nothing to merge, positions are the vertices.
+        mesh.positions.swap(objPositions);
+        for (u32 i = 0; i < corners.size(); ++i) {
+            mesh.indices[i] = corners[i].x;
+        }
+    }
+    else {
+        std::unordered_map<u64, u32> vertexMap;
+        vertexMap.reserve(objPositions.size() * 2);
+        mesh.positions.reserve(objPositions.size());
+        mesh.normals.reserve(objPositions.size());
+        for (u32 i = 0; i < corners.size(); ++i) {
+            const u64 key = ((u64)corners[i].x << 32) | corners[i].y;
+            std::unordered_map<u64, u32>::iterator it = vertexMap.find(key);
+            if (it == vertexMap.end()) {
+                it = vertexMap.insert(std::make_pair(key, (u32)mesh.positions.size())).first;
+                mesh.positions.push_back(objPositions[corners[i].x]);
+                // Missing or zero normals are left for computeNormals().
+                glm::vec3 n(0.0f);
+                if (corners[i].y != NO_NORMAL && glm::length(objNormals[corners[i].y]) > 0.0f) {
+                    n = glm::normalize(objNormals[corners[i].y]);
+                }
+                mesh.normals.push_back(n);
+            }
+            mesh.indices[i] = it->second;
+        }
+    }
+
+    mesh.computeNormals();
+    return true;
+}
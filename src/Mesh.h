@@ -0,0 +1,56 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "util.h"
+#include "BVH.h"
+
+// Indexed triangle mesh. Every vertex has a position and a normal; faces
+// index both with the same index (OBJ v/vn pairs are merged on load).
+struct Mesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<u32> indices; // three per triangle
+
+    u32 triangleCount() const { return (u32)(indices.size() / 3); }
+    Bounds bounds() const;
+
+    // Fills in area-weighted normals for vertices whose normal is zero.
+    void computeNormals();
+
+    // Uniformly scales and moves the mesh so its largest extent is `size`
+    // and its bounds are centred on `center`.
+    void fit(const glm::vec3& center, f32 size);
+
+    // Reads positions, normals and faces (v, v/vt, v//vn, v/vt/vn, negative
+    // indices); polygons are fanned into triangles. Everything else is skipped.
+    static bool LoadOBJ(const std::string& path, Mesh& mesh);
+
+    // Packs a unit vector into two snorm16 octahedral coordinates, the
+    // format unpackSnorm2x16 reads in raytrace.comp.
+    static u32 PackNormal(const glm::vec3& n);
+};
+
+// A placed copy of a shape (World::addShape()). Copies share the shape's
+// triangles and bottom-level hierarchy; only this is stored per copy.
+struct Instance {
+    u32 shape;
+    u32 material;
+    glm::mat4 transform; // object to world
+};
+
+// Instance as raytrace.comp reads it, stored after the triangles of the
+// mesh triangle buffer: the rows of the 3x4 world-to-object transform,
+// then the root of the shape's hierarchy and the material.
+struct InstanceRecord {
+    glm::vec4 worldToObject[3];
+    u32 root;
+    u32 material;
+    u32 padding[2];
+};
+
+static_assert(sizeof(InstanceRecord) == 4 * sizeof(glm::uvec4), "InstanceRecord must fill whole triangle entries");
+
+#endif
@@ -1,22 +1,32 @@
 #include "ComputeShader.h"
 #include "VertexBufferLayout.h"
+#include "Renderer.h"
 
 namespace gl {
-    ComputeShader::ComputeShader(const std::string& path, const glm::vec3& groups)
-        : ShaderProgram(), groups(groups)
+    ComputeShader::ComputeShader(const std::string& path, const glm::vec3& groups, const std::string& defines)
+        : ShaderProgram(), groups(groups), barriers(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT)
     {
-        attach_shader(GL_COMPUTE_SHADER, path);
+        attach_shader(GL_COMPUTE_SHADER, path, defines);
         link();
     }
 
     void ComputeShader::use() const {
-        glDispatchCompute(groups.x, groups.y, groups.z);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        GLCALL(glDispatchCompute(groups.x, groups.y, groups.z));
+        GLCALL(glMemoryBarrier(barriers));
+    }
+
+    void ComputeShader::useIndirect(u32 offset) const {
+        GLCALL(glDispatchComputeIndirect((GLintptr)offset));
+        GLCALL(glMemoryBarrier(barriers));
     }
 
     void ComputeShader::updateGroups(const glm::vec3& groups) {
         this->groups = groups;
     }
 
+    void ComputeShader::setBarriers(u32 barriers) {
+        this->barriers = barriers;
+    }
+
 }
 
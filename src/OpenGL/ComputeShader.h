@@ -5,13 +5,20 @@ namespace gl {
     class ComputeShader : public ShaderProgram {
     private:
         glm::vec3 groups;
+        u32 barriers;
 
     public:
-        ComputeShader(const std::string& path, const glm::vec3& groups);
+        ComputeShader(const std::string& path, const glm::vec3& groups, const std::string& defines = std::string());
         ~ComputeShader() = default;
 
         void use() const;
+        // Dispatches the group counts stored at byte `offset` of the buffer
+        // bound to GL_DISPATCH_INDIRECT_BUFFER.
+        void useIndirect(u32 offset) const;
         void updateGroups(const glm::vec3& groups);
+        // glMemoryBarrier() bits issued after every dispatch, by default
+        // GL_SHADER_IMAGE_ACCESS_BARRIER_BIT.
+        void setBarriers(u32 barriers);
 
     };
     
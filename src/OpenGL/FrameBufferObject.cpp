@@ -10,25 +10,31 @@ namespace gl {
         bind();
         bindTexture(tex, slot);
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        GLenum status;
+        GLCALL(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
             std::cout << "Framebuffer not complete!" << std::endl;
         }
     }
 
     FrameBufferObject::~FrameBufferObject() {
-        glDeleteFramebuffers(1, &m_id);
+        GLCALL(glDeleteFramebuffers(1, &m_id));
     }
 
     void FrameBufferObject::bind() const {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+        GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, m_id));
     }
 
     void FrameBufferObject::bindTexture(const Texture2D& tex, u32 slot) {
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex.m_id, slot); 
+        GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex.m_id, slot));
+    }
+
+    void FrameBufferObject::bindDepth(const Texture2D& tex) {
+        GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex.m_id, 0));
     }
 
     void FrameBufferObject::unbind() const {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
     }
 
 }
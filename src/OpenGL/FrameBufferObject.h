@@ -14,6 +14,8 @@ namespace gl {
 
         void bind() const;
         void bindTexture(const Texture2D& tex, u32 slot = 0);
+        // Attaches a GL_DEPTH_COMPONENT texture as the depth buffer.
+        void bindDepth(const Texture2D& tex);
         void unbind() const;
 
     };
@@ -0,0 +1,172 @@
+#include "GpuProfiler.h"
+#include <cstring>
+#include "glad/glad.h"
+#include "Renderer.h"
+
+namespace gl {
+    GpuProfiler::GpuProfiler()
+        : m_passCount(0), m_active(-1), m_frame(0), m_resultFrame(-1), m_csv(nullptr), m_csvColumns(0)
+    {}
+
+    GpuProfiler::~GpuProfiler() {
+        release();
+        if (m_csv) {
+            fclose(m_csv);
+        }
+    }
+
+    void GpuProfiler::release() {
+        for (u32 pass = 0; pass < m_passCount; ++pass) {
+            for (std::vector<u32>& queries : m_passes[pass].queries) {
+                if (!queries.empty()) {
+                    GLCALL(glDeleteQueries((GLsizei)queries.size(), queries.data()));
+                    queries.clear();
+                }
+            }
+            m_passes[pass].spans[0] = m_passes[pass].spans[1] = 0;
+        }
+    }
+
+    bool GpuProfiler::openCsv(const std::string& path) {
+        if (m_csv) {
+            fclose(m_csv);
+        }
+        m_csv = fopen(path.c_str(), "w");
+        m_csvColumns = 0;
+        return m_csv != nullptr;
+    }
+
+    void GpuProfiler::begin(const char* name) {
+        const i32 found = findPass(name);
+        const u32 pass = found < 0 ? m_passCount : (u32)found;
+        if (pass == m_passCount) {
+            ASSERT(m_passCount < MAX_PASSES);
+            Pass& added = m_passes[m_passCount++];
+            added.name = name;
+            added.lastMs = 0;
+            added.averageMs = 0;
+            added.spans[0] = added.spans[1] = 0;
+        }
+
+        // Queries are created on first use, like the other GL objects that
+        // can live before the context does. Both sets get as many as the
+        // busiest frame needed, so steady frames allocate nothing.
+        const u32 set = m_frame & 1;
+        Pass& p = m_passes[pass];
+        if (p.queries[set].size() < 2 * (p.spans[set] + 1)) {
+            for (std::vector<u32>& queries : p.queries) {
+                u32 ids[2];
+                GLCALL(glGenQueries(2, ids));
+                queries.push_back(ids[0]);
+                queries.push_back(ids[1]);
+            }
+        }
+        GLCALL(glQueryCounter(p.queries[set][2 * p.spans[set]], GL_TIMESTAMP));
+        m_active = (i32)pass;
+    }
+
+    void GpuProfiler::end() {
+        if (m_active < 0) {
+            return;
+        }
+        const u32 set = m_frame & 1;
+        Pass& p = m_passes[m_active];
+        GLCALL(glQueryCounter(p.queries[set][2 * p.spans[set] + 1], GL_TIMESTAMP));
+        ++p.spans[set];
+        m_active = -1;
+    }
+
+    i32 GpuProfiler::findPass(const char* name) const {
+        for (u32 pass = 0; pass < m_passCount; ++pass) {
+            if (strcmp(m_passes[pass].name, name) == 0) {
+                return (i32)pass;
+            }
+        }
+        return -1;
+    }
+
+    void GpuProfiler::endFrame() {
+        ++m_frame;
+        // The set the next frame writes was last written the frame before
+        // this one.
+        if (m_frame >= 2) {
+            collect(m_frame & 1, m_frame - 2, false);
+        }
+    }
+
+    void GpuProfiler::finish() {
+        if (m_frame >= 2) {
+            collect(m_frame & 1, m_frame - 2, true);
+        }
+        if (m_frame >= 1) {
+            collect((m_frame - 1) & 1, m_frame - 1, true);
+        }
+    }
+
+    void GpuProfiler::collect(u32 set, u32 frame, bool wait) {
+        bool collected[MAX_PASSES] = {};
+        bool any = false;
+        for (u32 pass = 0; pass < m_passCount; ++pass) {
+            Pass& p = m_passes[pass];
+            const u32 spans = p.spans[set];
+            if (!spans) {
+                continue;
+            }
+            p.spans[set] = 0;
+            if (!wait) {
+                // Timestamps complete in order, so the last one stands for
+                // all of them.
+                i32 available = 0;
+                GLCALL(glGetQueryObjectiv(p.queries[set][2 * spans - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+                if (!available) {
+                    // Dropped rather than waited for; the query object is
+                    // reused by the next frame.
+                    continue;
+                }
+            }
+
+            f64 ms = 0;
+            for (u32 span = 0; span < spans; ++span) {
+                u64 start = 0, end = 0;
+                GLCALL(glGetQueryObjectui64v(p.queries[set][2 * span], GL_QUERY_RESULT, &start));
+                GLCALL(glGetQueryObjectui64v(p.queries[set][2 * span + 1], GL_QUERY_RESULT, &end));
+                ms += (end - start) * 1e-6;
+            }
+            p.lastMs = ms;
+            p.averageMs = p.averageMs == 0 ? p.lastMs : p.averageMs * 0.95 + p.lastMs * 0.05;
+            collected[pass] = true;
+            any = true;
+        }
+
+        if (!any) {
+            return;
+        }
+        m_resultFrame = (i32)frame;
+        if (!m_csv) {
+            return;
+        }
+        if (m_csvColumns != m_passCount) {
+            if (m_csvColumns) {
+                fprintf(m_csv, "\n");
+            }
+            fprintf(m_csv, "frame");
+            for (u32 pass = 0; pass < m_passCount; ++pass) {
+                fprintf(m_csv, ",%s_ms", m_passes[pass].name);
+            }
+            fprintf(m_csv, "\n");
+            m_csvColumns = m_passCount;
+        }
+        // Passes without a result this frame are left empty.
+        fprintf(m_csv, "%u", frame);
+        for (u32 pass = 0; pass < m_passCount; ++pass) {
+            if (collected[pass]) {
+                fprintf(m_csv, ",%.4f", m_passes[pass].lastMs);
+            }
+            else {
+                fprintf(m_csv, ",");
+            }
+        }
+        fprintf(m_csv, "\n");
+    }
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../util.h"
+
+namespace gl {
+    // Per-pass GPU times from a pair of GL_TIMESTAMP queries around each
+    // pass (GL_TIME_ELAPSED does not cover compute work on every driver).
+    // Each frame writes one of two query sets and reads back the other, one
+    // frame late, so the CPU never waits on the GPU for a result.
+    //
+    //     profiler.begin("raytrace"); ...dispatch...; profiler.end();
+    //     profiler.endFrame();
+    //
+    // Passes are timed one at a time; begin() while a pass is open is not
+    // supported. A pass begun several times in a frame, e.g. once per
+    // bounce, reports the sum of its spans.
+    class GpuProfiler {
+    public:
+        static const u32 MAX_PASSES = 12;
+
+    private:
+        struct Pass {
+            const char* name;
+            f64 lastMs;
+            f64 averageMs;
+            // Spans recorded this frame and their start/end query pairs,
+            // per query set; the pairs are kept for later frames.
+            u32 spans[2];
+            std::vector<u32> queries[2];
+        };
+
+        Pass m_passes[MAX_PASSES];
+        u32 m_passCount;
+        i32 m_active;
+        u32 m_frame;
+        i32 m_resultFrame;
+        FILE* m_csv;
+        // Passes named by the last header written to m_csv.
+        u32 m_csvColumns;
+
+        void collect(u32 set, u32 frame, bool wait);
+
+    public:
+        GpuProfiler();
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        // `name` is kept, not copied; pass string literals. At most
+        // MAX_PASSES distinct names.
+        void begin(const char* name);
+        void end();
+        // Reads back the previous frame if the GPU is done with it.
+        void endFrame();
+        // Waits for every outstanding query, e.g. before printing a summary.
+        void finish();
+        // Deletes the queries; call while the context is still current.
+        void release();
+
+        // Appends one row of per-pass milliseconds per collected frame. A
+        // pass that first runs later, e.g. one toggled on in the UI, starts
+        // a new section: a blank line and a header naming every pass.
+        bool openCsv(const std::string& path);
+
+        // Frames ended so far, i.e. the index of the frame being recorded.
+        inline u32 frame() const { return m_frame; }
+        // Frame the latest results were recorded in, -1 before the first.
+        inline i32 resultFrame() const { return m_resultFrame; }
+        // Index of the pass called `name`, -1 if it never ran.
+        i32 findPass(const char* name) const;
+
+        inline u32 passCount() const { return m_passCount; }
+        inline const char* passName(u32 pass) const { return m_passes[pass].name; }
+        inline f64 lastMs(u32 pass) const { return m_passes[pass].lastMs; }
+        // Exponential moving average, steadier for display.
+        inline f64 averageMs(u32 pass) const { return m_passes[pass].averageMs; }
+
+    };
+
+}
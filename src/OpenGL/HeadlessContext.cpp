@@ -0,0 +1,104 @@
+#include "HeadlessContext.h"
+#include "glad/glad.h"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+namespace gl {
+    HeadlessContext::HeadlessContext()
+        : m_display(nullptr), m_context(nullptr)
+    {}
+
+    HeadlessContext::~HeadlessContext() {
+        release();
+    }
+
+#ifdef __linux__
+    bool HeadlessContext::create(i32 major, i32 minor) {
+        release();
+
+        EGLDisplay display = EGL_NO_DISPLAY;
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            return false;
+        }
+        m_display = display;
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            release();
+            return false;
+        }
+
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, major,
+            EGL_CONTEXT_MINOR_VERSION, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        // Prefer a config-less context (EGL_KHR_no_config_context); older
+        // drivers need any config that can render desktop GL.
+        EGLContext context = eglCreateContext(display, (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT) {
+            const EGLint configAttribs[] = {
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+            };
+            EGLConfig config;
+            EGLint count = 0;
+            if (eglChooseConfig(display, configAttribs, &config, 1, &count) && count > 0) {
+                context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+            }
+        }
+        if (context == EGL_NO_CONTEXT) {
+            release();
+            return false;
+        }
+        m_context = context;
+
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) ||
+            !gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+            release();
+            return false;
+        }
+        return true;
+    }
+
+    void HeadlessContext::release() {
+        if (m_display) {
+            eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (m_context) {
+                eglDestroyContext(m_display, m_context);
+            }
+            eglTerminate(m_display);
+        }
+        m_display = nullptr;
+        m_context = nullptr;
+    }
+#else
+    bool HeadlessContext::create(i32 major, i32 minor) {
+        (void)major;
+        (void)minor;
+        return false;
+    }
+
+    void HeadlessContext::release() {
+        m_display = nullptr;
+        m_context = nullptr;
+    }
+#endif
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "../util.h"
+
+namespace gl {
+    // Offscreen OpenGL context with no window and no display server, for
+    // batch rendering. Uses EGL on the Mesa surfaceless platform (llvmpipe
+    // or a GPU driver) and loads the GL entry points through glad. On other
+    // platforms create() fails and callers fall back to a hidden window.
+    class HeadlessContext
+    {
+    private:
+        void* m_display;
+        void* m_context;
+
+    public:
+        HeadlessContext();
+        ~HeadlessContext();
+
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+        bool create(i32 major, i32 minor);
+        void release();
+
+        inline bool valid() const { return m_context != nullptr; }
+    };
+
+}
@@ -1,18 +1,20 @@
 #include "Image2D.h"
 #include "glad/glad.h"
+#include "Renderer.h"
+#include <cstddef>
 
 namespace gl {
     Image2D::Image2D(i32 width, i32 height, u32 access)
         : m_width(width), m_height(height)
     {
-        glGenTextures(1, &m_id);
-        glBindTexture(GL_TEXTURE_2D, m_id);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+        GLCALL(glGenTextures(1, &m_id));
+        GLCALL(glBindTexture(GL_TEXTURE_2D, m_id));
+        GLCALL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height));
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 
-        glBindImageTexture(0, m_id, 0, GL_FALSE, 0, access, GL_RGBA32F);
+        GLCALL(glBindImageTexture(0, m_id, 0, GL_FALSE, 0, access, GL_RGBA32F));
     }
 
     Image2D::Image2D(i32 width, i32 height)
@@ -20,16 +22,16 @@ namespace gl {
     {}
 
     Image2D::~Image2D() {
-        glDeleteTextures(1, &m_id);
+        GLCALL(glDeleteTextures(1, &m_id));
     }
 
     void Image2D::bindTexture(u32 slot) const {
-        glActiveTexture(GL_TEXTURE0 + slot);
-        glBindTexture(GL_TEXTURE_2D, m_id);
+        GLCALL(glActiveTexture(GL_TEXTURE0 + slot));
+        GLCALL(glBindTexture(GL_TEXTURE_2D, m_id));
     }
 
     void Image2D::bind(u32 slot, i32 access) const {
-        glBindImageTexture(slot, m_id, 0, GL_FALSE, 0, access, GL_RGBA32F);
+        GLCALL(glBindImageTexture(slot, m_id, 0, GL_FALSE, 0, access, GL_RGBA32F));
     }
 
     void Image2D::bind(u32 slot) const {
@@ -37,23 +39,35 @@ namespace gl {
     }
 
     void Image2D::unbind() const {
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLCALL(glBindTexture(GL_TEXTURE_2D, 0));
     }
 
     void Image2D::resize(i32 width, i32 height) {
         m_width = width;
         m_height = height;
 
-        glDeleteTextures(1, &m_id);
+        GLCALL(glDeleteTextures(1, &m_id));
 
-        glGenTextures(1, &m_id);
-        glBindTexture(GL_TEXTURE_2D, m_id);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+        GLCALL(glGenTextures(1, &m_id));
+        GLCALL(glBindTexture(GL_TEXTURE_2D, m_id));
+        GLCALL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height));
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 
-        glBindImageTexture(0, m_id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        GLCALL(glBindImageTexture(0, m_id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
+    }
+
+    void Image2D::copyTo(const Image2D& target) const {
+        GLCALL(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT));
+        GLCALL(glCopyImageSubData(m_id, GL_TEXTURE_2D, 0, 0, 0, 0, target.m_id, GL_TEXTURE_2D, 0, 0, 0, 0, m_width, m_height, 1));
+    }
+
+    void Image2D::read(std::vector<f32>& pixels) const {
+        pixels.resize((size_t)m_width * m_height * 4);
+        GLCALL(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT));
+        GLCALL(glBindTexture(GL_TEXTURE_2D, m_id));
+        GLCALL(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data()));
     }
 
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include "../util.h"
 
 namespace gl {
@@ -18,6 +19,14 @@ namespace gl {
         void unbind() const;
 
         void resize(i32 width, i32 height);
+        // Copies the whole image into `target`, which must be as large.
+        void copyTo(const Image2D& target) const;
+
+        // Reads the whole image back as RGBA floats, bottom row first.
+        void read(std::vector<f32>& pixels) const;
+
+        inline i32 width() const { return m_width; }
+        inline i32 height() const { return m_height; }
 
     };
 }
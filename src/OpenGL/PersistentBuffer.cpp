@@ -0,0 +1,118 @@
+#include "PersistentBuffer.h"
+#include "glad/glad.h"
+#include "Renderer.h"
+
+namespace gl {
+    PersistentBuffer::PersistentBuffer()
+        : m_id(0), m_target(0), m_size(0), m_stride(0), m_regions(0), m_current(0), m_mapped(nullptr), m_waits(0)
+    {}
+
+    PersistentBuffer::~PersistentBuffer() {
+        release();
+    }
+
+    bool PersistentBuffer::create(u32 size, u32 regions, Target target) {
+        release();
+        if (size == 0 || regions == 0) {
+            return false;
+        }
+
+        // glBindBufferRange needs every region to start on this alignment.
+        m_target = target == Uniform ? GL_UNIFORM_BUFFER : GL_SHADER_STORAGE_BUFFER;
+        i32 alignment = 1;
+        GLCALL(glGetIntegerv(target == Uniform ? GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+                : GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        const u32 align = alignment > 0 ? (u32)alignment : 1;
+        m_size = size;
+        m_stride = (size + align - 1) / align * align;
+        m_regions = regions;
+        // begin() advances first, so the first frame writes region 0.
+        m_current = regions - 1;
+        m_fences.assign(regions, nullptr);
+        m_waits = 0;
+
+        GLCALL(glGenBuffers(1, &m_id));
+        GLCALL(glBindBuffer(m_target, m_id));
+        const GLsizeiptr total = (GLsizeiptr)m_stride * regions;
+        if (GLAD_GL_VERSION_4_4) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLCALL(glBufferStorage(m_target, total, nullptr, flags));
+            GLCALL(m_mapped = (u8*)glMapBufferRange(m_target, 0, total, flags));
+            if (!m_mapped) {
+                release();
+                return false;
+            }
+        }
+        else {
+            GLCALL(glBufferData(m_target, total, nullptr, GL_STREAM_DRAW));
+            m_staging.resize(size);
+        }
+        return true;
+    }
+
+    void PersistentBuffer::release() {
+        for (void*& fence : m_fences) {
+            if (fence) {
+                GLCALL(glDeleteSync((GLsync)fence));
+                fence = nullptr;
+            }
+        }
+        if (m_id) {
+            if (m_mapped) {
+                GLCALL(glBindBuffer(m_target, m_id));
+                GLCALL(glUnmapBuffer(m_target));
+            }
+            GLCALL(glDeleteBuffers(1, &m_id));
+        }
+        m_id = 0;
+        m_mapped = nullptr;
+        m_staging.clear();
+    }
+
+    void* PersistentBuffer::begin() {
+        m_current = (m_current + 1) % m_regions;
+
+        void*& fence = m_fences[m_current];
+        if (fence) {
+            // Poll first so a region the GPU is already done with is not
+            // counted as a wait.
+            GLenum status;
+            GLCALL(status = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0));
+            if (status == GL_TIMEOUT_EXPIRED) {
+                ++m_waits;
+                do {
+                    GLCALL(status = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+                } while (status == GL_TIMEOUT_EXPIRED);
+            }
+            GLCALL(glDeleteSync((GLsync)fence));
+            fence = nullptr;
+        }
+
+        return m_mapped ? m_mapped + (size_t)m_current * m_stride : m_staging.data();
+    }
+
+    void PersistentBuffer::end(u32 size) {
+        // Coherent mappings need nothing more; the fallback uploads here.
+        if (!m_mapped && size) {
+            GLCALL(glBindBuffer(m_target, m_id));
+            GLCALL(glBufferSubData(m_target, (GLintptr)m_current * m_stride, size, m_staging.data()));
+        }
+    }
+
+    void PersistentBuffer::binding(int point) const {
+        binding(point, 0, m_size);
+    }
+
+    void PersistentBuffer::binding(int point, u32 offset, u32 size) const {
+        GLCALL(glBindBufferRange(m_target, point, m_id, (GLintptr)m_current * m_stride + offset, size));
+    }
+
+    void PersistentBuffer::fence() {
+        void*& fence = m_fences[m_current];
+        if (fence) {
+            GLCALL(glDeleteSync((GLsync)fence));
+        }
+        GLCALL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    }
+
+}
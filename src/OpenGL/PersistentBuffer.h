@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "../util.h"
+
+namespace gl {
+    // Shader storage or uniform data rewritten every frame. The buffer holds
+    // `regions` copies of the data and stays mapped (glBufferStorage with
+    // GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT), so the CPU writes one
+    // region while the GPU still reads the others; a fence per region
+    // makes the CPU wait only when it catches up with the GPU.
+    //
+    //     void* data = buffer.begin(); ...write...; buffer.end(size);
+    //     buffer.binding(point); ...dispatch...; buffer.fence();
+    //
+    // Without GL 4.4 the regions are filled with glBufferSubData from a
+    // CPU copy instead, which keeps the interface but not the savings.
+    class PersistentBuffer {
+    public:
+        enum Target { Storage, Uniform };
+
+    private:
+        u32 m_id;
+        u32 m_target;
+        u32 m_size;
+        u32 m_stride;
+        u32 m_regions;
+        u32 m_current;
+        u8* m_mapped;
+        std::vector<u8> m_staging;
+        std::vector<void*> m_fences;
+        u32 m_waits;
+
+    public:
+        static const u32 DEFAULT_REGIONS = 3;
+
+        PersistentBuffer();
+        ~PersistentBuffer();
+
+        PersistentBuffer(const PersistentBuffer&) = delete;
+        PersistentBuffer& operator=(const PersistentBuffer&) = delete;
+
+        // Allocates `regions` regions of `size` bytes each; false if the
+        // buffer could not be created or mapped.
+        bool create(u32 size, u32 regions = DEFAULT_REGIONS, Target target = Storage);
+        // Unmaps and deletes the buffer; call while the context is current.
+        void release();
+
+        // Moves to the next region and returns it for writing, after
+        // waiting for the GPU to finish the commands fenced on it.
+        void* begin();
+        // Makes the first `size` bytes written since begin() visible.
+        void end(u32 size);
+        // Binds the current region, or `size` bytes of it from `offset`, to
+        // `point` of the buffer's target.
+        void binding(int point) const;
+        void binding(int point, u32 offset, u32 size) const;
+        // Marks the commands that read the current region; call after them.
+        void fence();
+
+        inline bool persistent() const { return m_mapped != nullptr; }
+        inline u32 size() const { return m_size; }
+        // Times begin() found its region still in use by the GPU.
+        inline u32 waits() const { return m_waits; }
+
+    };
+
+}
@@ -2,8 +2,15 @@
 #include "glad/glad.h"
 
 namespace gl {
+    static u64 s_callCount = 0;
+
+    u64 GLCallCount() {
+        return s_callCount;
+    }
+
     void GLClearError()
     {
+        ++s_callCount;
         while(glGetError() != GL_NO_ERROR);
     }
 
@@ -16,6 +16,9 @@
 namespace gl {
     void GLClearError();
     bool GLLogCall(const char* function, const char* file, int line);
+    // Calls made through GLCALL so far; the difference over a frame is
+    // that frame's driver call count.
+    u64 GLCallCount();
 
     class Renderer
     {
@@ -1,12 +1,49 @@
 #include "ShaderProgram.h"
 #include "Renderer.h"
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 #include "glad/glad.h"
 
 #include "glm/gtc/type_ptr.hpp"
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Header of a binary cache file; the program binary follows it.
+struct ProgramBinaryHeader {
+    char magic[4];
+    u32 format;
+    u32 length;
+    u32 pad;
+    u64 key;
+};
+
+static const char PROGRAM_BINARY_MAGIC[4] = { 'R', 'T', 'P', 'B' };
+
+// FNV-1a, enough to tell sources and drivers apart.
+static u64 hashBytes(u64 h, const void* data, size_t size) {
+    const u8* bytes = (const u8*)data;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static u64 hashString(u64 h, const char* str) {
+    // The terminator separates consecutive strings.
+    return hashBytes(h, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
 namespace gl {
+    std::string ShaderProgram::s_binary_cache;
+
     ShaderProgram::ShaderProgram()
+        : m_cached(false)
     {
         GLCALL(m_id = glCreateProgram());
     }
@@ -15,9 +52,21 @@ namespace gl {
         m_id = shader.m_id;
         error = shader.error;
         m_uniform_location_cache = shader.m_uniform_location_cache;
+        m_cached = false;
         m_id = 0;
     }
 
+    void ShaderProgram::set_binary_cache(const std::string& directory) {
+        s_binary_cache = directory;
+        if (!directory.empty()) {
+#ifdef _WIN32
+            _mkdir(directory.c_str());
+#else
+            mkdir(directory.c_str(), 0755);
+#endif
+        }
+    }
+
     ShaderProgram::~ShaderProgram()
     {
         release();
@@ -30,18 +79,128 @@ namespace gl {
         }
     }
 
-    void ShaderProgram::attach_shader(u32 type, const std::string& path)
+    void ShaderProgram::attach_shader(u32 type, const std::string& path, const std::string& defines)
     {
-        u32 shader = compile_shader(shader_source(path), type);
-        if (shader) {
-            GLCALL(glAttachShader(m_id, shader));
-            GLCALL(glDeleteShader(shader));
+        if (m_name.empty()) {
+            const size_t slash = path.find_last_of("/\\");
+            m_name = slash == std::string::npos ? path : path.substr(slash + 1);
         }
+        std::string source = shader_source(path);
+        if (!defines.empty()) {
+            const size_t eol = source.find('\n');
+            source.insert(eol == std::string::npos ? source.size() : eol + 1, defines);
+        }
+        m_sources.push_back(std::make_pair(type, source));
     }
 
     void ShaderProgram::link()
     {
-        GLCALL(glLinkProgram(m_id));
+        const u64 key = binary_key();
+        std::string cachePath;
+        if (key) {
+            char name[32];
+            snprintf(name, sizeof(name), "-%016llx.bin", (unsigned long long)key);
+            cachePath = s_binary_cache + "/" + m_name + name;
+        }
+        m_cached = key && load_binary(cachePath, key);
+        if (!m_cached) {
+            for (const std::pair<u32, std::string>& source : m_sources) {
+                u32 shader = compile_shader(source.second, source.first);
+                if (shader) {
+                    GLCALL(glAttachShader(m_id, shader));
+                    GLCALL(glDeleteShader(shader));
+                }
+            }
+            if (!cachePath.empty()) {
+                GLCALL(glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+            }
+            GLCALL(glLinkProgram(m_id));
+
+            int result;
+            GLCALL(glGetProgramiv(m_id, GL_LINK_STATUS, &result));
+            if (result == GL_FALSE) {
+                char infolog[512];
+                GLCALL(glGetProgramInfoLog(m_id, 512, NULL, infolog));
+                error.emplace_back(infolog);
+            }
+            else if (!cachePath.empty()) {
+                save_binary(cachePath, key);
+            }
+        }
+        m_sources.clear();
+    }
+
+    u64 ShaderProgram::binary_key() const {
+        i32 formats = 0;
+        if (s_binary_cache.empty() || m_sources.empty()) {
+            return 0;
+        }
+        GLCALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+        if (formats <= 0) {
+            return 0;
+        }
+
+        // Binaries are only valid for the driver build that wrote them.
+        u64 key = 14695981039346656037ull;
+        key = hashString(key, (const char*)glGetString(GL_VENDOR));
+        key = hashString(key, (const char*)glGetString(GL_RENDERER));
+        key = hashString(key, (const char*)glGetString(GL_VERSION));
+        for (const std::pair<u32, std::string>& source : m_sources) {
+            key = hashBytes(key, &source.first, sizeof(source.first));
+            key = hashString(key, source.second.c_str());
+        }
+        return key ? key : 1;
+    }
+
+    bool ShaderProgram::load_binary(const std::string& path, u64 key) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+
+        ProgramBinaryHeader header;
+        std::vector<u8> binary;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            !memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic)) && header.key == key;
+        if (ok) {
+            binary.resize(header.length);
+            ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+        if (!ok) {
+            return false;
+        }
+
+        // A driver update may reject the binary; the caller then compiles.
+        GLCALL(glProgramBinary(m_id, header.format, binary.data(), (GLsizei)binary.size()));
+        int result;
+        GLCALL(glGetProgramiv(m_id, GL_LINK_STATUS, &result));
+        return result == GL_TRUE;
+    }
+
+    void ShaderProgram::save_binary(const std::string& path, u64 key) const {
+        i32 length = 0;
+        GLCALL(glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0) {
+            return;
+        }
+
+        ProgramBinaryHeader header = ProgramBinaryHeader();
+        memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic));
+        std::vector<u8> binary(length);
+        GLenum format = 0;
+        GLCALL(glGetProgramBinary(m_id, length, nullptr, &format, binary.data()));
+        header.format = format;
+        header.length = (u32)length;
+        header.key = key;
+
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) {
+            return;
+        }
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary.data(), 1, binary.size(), file);
+        fclose(file);
     }
 
     void ShaderProgram::bind() const
@@ -103,6 +262,13 @@ namespace gl {
         }
     }
 
+    void ShaderProgram::set_2i(const std::string& name, const glm::ivec2& v) {
+        int id = uniform_location(name);
+        if (id != -1) {
+            GLCALL(glUniform2i(id, v.x, v.y));
+        }
+    }
+
     void ShaderProgram::set_1u(const std::string& name, u32 v0) {
         int id = uniform_location(name);
         if (id != -1) {
@@ -134,6 +300,59 @@ namespace gl {
         }
     }
 
+    i32 ShaderProgram::find_uniform(const char* name) const {
+        GLCALL(i32 location = glGetUniformLocation(m_id, name));
+        return location;
+    }
+
+    void ShaderProgram::set(Uniform<f32> uniform, f32 v0) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform1f(uniform.location, v0));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<i32> uniform, i32 v0) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform1i(uniform.location, v0));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<u32> uniform, u32 v0) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform1ui(uniform.location, v0));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<glm::vec2> uniform, const glm::vec2& v) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform2f(uniform.location, v.x, v.y));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<glm::ivec2> uniform, const glm::ivec2& v) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform2i(uniform.location, v.x, v.y));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<glm::vec3> uniform, const glm::vec3& v) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform3f(uniform.location, v.x, v.y, v.z));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<glm::vec4> uniform, const glm::vec4& v) {
+        if (uniform.location != -1) {
+            GLCALL(glUniform4f(uniform.location, v.x, v.y, v.z, v.w));
+        }
+    }
+
+    void ShaderProgram::set(Uniform<glm::mat4> uniform, const glm::mat4& m) {
+        if (uniform.location != -1) {
+            GLCALL(glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(m)));
+        }
+    }
+
     u32 ShaderProgram::compile_shader(const std::string& source, u32 type)
     {
         GLCALL(u32 id = glCreateShader(type));
@@ -157,20 +376,18 @@ namespace gl {
 
     const std::string ShaderProgram::shader_source(const std::string& path)
     {
-        std::ifstream stream(path);
-        std::string line;
-        std::string source;
-        while(getline(stream, line))
-            source += line + "\n";
-        stream.close();
-        return source;
+        std::ifstream stream(path, std::ios::binary);
+        std::stringstream source;
+        source << stream.rdbuf();
+        return source.str();
     }
 
     i32 ShaderProgram::uniform_location(const std::string& name)
     {
-        if(m_uniform_location_cache.find(name) != m_uniform_location_cache.end())
-            return m_uniform_location_cache[name];
-        GLCALL(i32 location = glGetUniformLocation(m_id, name.c_str()));
+        std::unordered_map<std::string, i32>::const_iterator it = m_uniform_location_cache.find(name);
+        if (it != m_uniform_location_cache.end())
+            return it->second;
+        i32 location = find_uniform(name.c_str());
         if (location != -1) {
             m_uniform_location_cache[name] = location;
         }
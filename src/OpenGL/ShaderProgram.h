@@ -7,16 +7,34 @@
 #include <string>
 
 namespace gl {
+    // Location of a uniform of GLSL type T, looked up once with
+    // ShaderProgram::get_uniform() after linking. Setting through a handle
+    // skips the name lookup; -1 (an unused uniform) makes sets a no-op.
+    template <typename T>
+    struct Uniform {
+        i32 location = -1;
+    };
+
     class ShaderProgram
     {
     private:
         std::unordered_map<std::string, i32> m_uniform_location_cache;
         std::vector<std::string> error;
         u32 m_id;
+        // Sources attached since the last link(), compiled by link() unless
+        // the binary cache has the program.
+        std::vector<std::pair<u32, std::string>> m_sources;
+        std::string m_name;
+        bool m_cached;
+
+        static std::string s_binary_cache;
 
         u32 compile_shader(const std::string& source, u32 type);
         const std::string shader_source(const std::string& path);
         i32 uniform_location(const std::string& name);
+        u64 binary_key() const;
+        bool load_binary(const std::string& path, u64 key);
+        void save_binary(const std::string& path, u64 key) const;
 
     public:
         ShaderProgram();
@@ -24,8 +42,18 @@ namespace gl {
         virtual ~ShaderProgram();
 
         void create();
-        void attach_shader(u32 type, const std::string& path);
+        // `defines` ("#define NAME VALUE" lines) is inserted after the
+        // source's #version line.
+        void attach_shader(u32 type, const std::string& path, const std::string& defines = std::string());
+        // Compiles the attached shaders and links them, or loads the program
+        // from the binary cache if it holds one for the same sources.
         void link();
+        // True when the last link() came from the binary cache.
+        inline bool cached() const { return m_cached; }
+
+        // Directory for glGetProgramBinary() output, keyed by the sources
+        // and the driver; created when missing. Empty disables the cache.
+        static void set_binary_cache(const std::string& directory);
         void bind() const;
         void unbind() const;
         void release();
@@ -36,11 +64,30 @@ namespace gl {
         void set_2f(const std::string& name, const glm::vec2& v);
         void set_2f(const std::string& name, f32* v);
         void set_2f(const std::string& name, f32 v0, f32 v1);
+        void set_2i(const std::string& name, const glm::ivec2& v);
         void set_1u(const std::string& name, u32 v0);
         void set_1i(const std::string& name, i32 v0);
         void set_1f(const std::string& name, f32 v0);
         void set_m4(const std::string& name, const glm::mat4& m);
 
+        template <typename T>
+        Uniform<T> get_uniform(const char* name) const {
+            Uniform<T> uniform;
+            uniform.location = find_uniform(name);
+            return uniform;
+        }
+        i32 find_uniform(const char* name) const;
+
+        // The program must be bound.
+        void set(Uniform<f32> uniform, f32 v0);
+        void set(Uniform<i32> uniform, i32 v0);
+        void set(Uniform<u32> uniform, u32 v0);
+        void set(Uniform<glm::vec2> uniform, const glm::vec2& v);
+        void set(Uniform<glm::ivec2> uniform, const glm::ivec2& v);
+        void set(Uniform<glm::vec3> uniform, const glm::vec3& v);
+        void set(Uniform<glm::vec4> uniform, const glm::vec4& v);
+        void set(Uniform<glm::mat4> uniform, const glm::mat4& m);
+
         const std::vector<std::string> getShaderError() const { return error; }
         void clearShaderError() { error.resize(0); }
 
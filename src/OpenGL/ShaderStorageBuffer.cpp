@@ -3,31 +3,57 @@
 #include "Renderer.h"
 
 namespace gl {
-    ShaderStorageBuffer::ShaderStorageBuffer(const void* data, u32 size) {
-        GLCALL(glGenBuffers(1, &m_id));
+    ShaderStorageBuffer::ShaderStorageBuffer()
+        : m_id(0)
+    {}
+
+    ShaderStorageBuffer::ShaderStorageBuffer(const void* data, u32 size)
+        : m_id(0)
+    {
         setBuffer(data, size);
     }
 
     ShaderStorageBuffer::~ShaderStorageBuffer() {
-        GLCALL(glDeleteBuffers(0, &m_id));
+        release();
+    }
+
+    void ShaderStorageBuffer::release() {
+        if (m_id) {
+            GLCALL(glDeleteBuffers(1, &m_id));
+            m_id = 0;
+        }
     }
 
     void ShaderStorageBuffer::setBuffer(const void* data, u32 size) {
+        // The GL object is created on first upload so a buffer can live in
+        // objects that are also used without a context (e.g. the CPU tracer).
+        if (!m_id) {
+            GLCALL(glGenBuffers(1, &m_id));
+        }
         bind();
         GLCALL(glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW));
     }
 
-    void ShaderStorageBuffer::updateBuffer(const void* data, u32 size) {
+    void ShaderStorageBuffer::updateBuffer(const void* data, u32 size, u32 offset) {
         bind();
-        GLCALL(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data));
+        GLCALL(glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data));
     }
 
-    void* ShaderStorageBuffer::getBuffer() const {
-        GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_id));
-        void* mappedData = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+    const void* ShaderStorageBuffer::map() const {
+        bind();
+        const void* data;
+        GLCALL(data = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY));
+        return data;
+    }
 
+    void ShaderStorageBuffer::unmap() const {
+        bind();
         GLCALL(glUnmapBuffer(GL_SHADER_STORAGE_BUFFER));
-        return mappedData;
+    }
+
+    void ShaderStorageBuffer::read(void* data, u32 size) const {
+        bind();
+        GLCALL(glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data));
     }
 
     void ShaderStorageBuffer::bind() const {
@@ -43,4 +69,8 @@ namespace gl {
         GLCALL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
     }
 
+    void ShaderStorageBuffer::bindIndirect() const {
+        GLCALL(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_id));
+    }
+
 }
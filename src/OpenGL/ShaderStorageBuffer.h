@@ -8,15 +8,27 @@ namespace gl {
         u32 m_id;
 
     public:
+        ShaderStorageBuffer();
         ShaderStorageBuffer(const void* data, u32 size);
         ~ShaderStorageBuffer();
 
         void setBuffer(const void* data, u32 size);
-        void updateBuffer(const void* data, u32 size);
-        void* getBuffer() const;
+        // Overwrites `size` bytes starting at byte `offset`; `data` points
+        // at the new bytes, not at the start of the buffer.
+        void updateBuffer(const void* data, u32 size, u32 offset = 0);
+        // Maps the buffer for reading; the pointer stays valid until
+        // unmap(), which must come before the buffer is used again.
+        const void* map() const;
+        void unmap() const;
+        // Copies the first `size` bytes back to `data`; waits for the GPU.
+        void read(void* data, u32 size) const;
         void bind() const;
         void binding(int point = 0) const;
         void unbind() const;
+        // Binds the buffer as the source of glDispatchComputeIndirect().
+        void bindIndirect() const;
+        // Deletes the buffer; call while the context is current.
+        void release();
 
     };
 
@@ -1,6 +1,7 @@
 #include "VertexArray.h"
 #include "VertexBufferLayout.h"
 #include "glad/glad.h"
+#include "Renderer.h"
 
 namespace gl {
     VertexArray::VertexArray()
@@ -22,8 +23,8 @@ namespace gl {
         for(u32 i = 0; i < elements.size(); i++)
         {
             const auto& element = elements[i];
-            glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.stride(), (void*)offset);
-            glEnableVertexAttribArray(i);
+            GLCALL(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.stride(), (void*)offset));
+            GLCALL(glEnableVertexAttribArray(i));
             offset += element.count*VertexBufferElement::type_size(element.type);
         }
     }
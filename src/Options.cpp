@@ -0,0 +1,147 @@
+#include "Options.h"
+#include "Scenes.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void printUsage(const char* program) {
+    printf("usage: %s [--cpu] [--headless | --bench | --bench-upload] [--scene NAME] [--mesh FILE.obj] [--cache FILE] [--shader-cache DIR | --no-shader-cache] [--frames N] [--size WxH] [--threads N] [--bounces N] [--no-light-sampling] [--no-roulette] [--sampler pcg|sobol] [--uber-kernel] [--wavefront] [--sort-materials] [--raster-primary] [--packed-primitives] [--adaptive THRESHOLD] [--sample-heatmap] [--denoise] [--no-temporal] [--pan DEGREES] [--profile FILE.csv] [--output FILE.pfm|FILE.png|FILE.json]\n", program);
+    printf("scenes:");
+    for (u32 i = 0; i < sceneCount; ++i) {
+        printf(" %s", sceneTable[i].name);
+    }
+    printf("\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--cpu")) {
+            opt.cpu = true;
+        }
+        else if (!strcmp(arg, "--headless")) {
+            opt.headless = true;
+        }
+        else if (!strcmp(arg, "--bench")) {
+            // The GPU benchmark never opens a window.
+            opt.bench = true;
+            opt.headless = true;
+        }
+        else if (!strcmp(arg, "--bench-upload")) {
+            opt.benchUpload = true;
+            opt.headless = true;
+        }
+        else if (!strcmp(arg, "--scene") && value) {
+            opt.scene = value;
+            ++i;
+        }
+        else if (!strcmp(arg, "--mesh") && value) {
+            opt.mesh = value;
+            ++i;
+        }
+        else if (!strcmp(arg, "--cache") && value) {
+            opt.cache = value;
+            ++i;
+        }
+        else if (!strcmp(arg, "--shader-cache") && value) {
+            opt.shaderCache = value;
+            ++i;
+        }
+        else if (!strcmp(arg, "--no-shader-cache")) {
+            opt.shaderCache.clear();
+        }
+        else if (!strcmp(arg, "--frames") && value) {
+            opt.frames = (u32)atoi(value);
+            ++i;
+        }
+        else if (!strcmp(arg, "--size") && value) {
+            if (sscanf(value, "%dx%d", &opt.resolution.x, &opt.resolution.y) != 2) {
+                return false;
+            }
+            ++i;
+        }
+        else if (!strcmp(arg, "--threads") && value) {
+            opt.threads = (u32)atoi(value);
+            ++i;
+        }
+        else if (!strcmp(arg, "--bounces") && value) {
+            opt.bounces = atoi(value);
+            ++i;
+        }
+        else if (!strcmp(arg, "--no-light-sampling")) {
+            opt.lightSampling = false;
+        }
+        else if (!strcmp(arg, "--no-roulette")) {
+            opt.roulette = false;
+        }
+        else if (!strcmp(arg, "--sampler") && value) {
+            if (!strcmp(value, "pcg")) {
+                opt.sampler = World::SAMPLER_PCG;
+            }
+            else if (!strcmp(value, "sobol")) {
+                opt.sampler = World::SAMPLER_SOBOL;
+            }
+            else {
+                return false;
+            }
+            ++i;
+        }
+        else if (!strcmp(arg, "--uber-kernel")) {
+            opt.uberKernel = true;
+        }
+        else if (!strcmp(arg, "--wavefront")) {
+            opt.wavefront = true;
+        }
+        else if (!strcmp(arg, "--sort-materials")) {
+            opt.wavefront = true;
+            opt.sortMaterials = true;
+        }
+        else if (!strcmp(arg, "--raster-primary")) {
+            opt.rasterPrimary = true;
+        }
+        else if (!strcmp(arg, "--packed-primitives")) {
+            opt.packedPrimitives = true;
+        }
+        else if (!strcmp(arg, "--adaptive") && value) {
+            opt.adaptiveThreshold = (f32)atof(value);
+            ++i;
+        }
+        else if (!strcmp(arg, "--sample-heatmap")) {
+            opt.sampleHeatmap = true;
+        }
+        else if (!strcmp(arg, "--denoise")) {
+            opt.denoise = true;
+        }
+        else if (!strcmp(arg, "--no-temporal")) {
+            opt.temporal = false;
+        }
+        else if (!strcmp(arg, "--pan") && value) {
+            opt.pan = (f32)atof(value);
+            ++i;
+        }
+        else if (!strcmp(arg, "--profile") && value) {
+            opt.profile = value;
+            ++i;
+        }
+        else if (!strcmp(arg, "--output") && value) {
+            opt.output = value;
+            ++i;
+        }
+        else {
+            return false;
+        }
+    }
+    // Buffer uploads, the wavefront passes, primary rasterization, the
+    // packed primitive layout, adaptive sampling, the Sobol sampler and
+    // camera motion only exist on the GPU backend.
+    if (opt.cpu && (opt.benchUpload || opt.wavefront || opt.rasterPrimary || opt.packedPrimitives ||
+                opt.adaptiveThreshold > 0 || opt.sampleHeatmap || opt.sampler != World::SAMPLER_PCG || opt.pan != 0)) {
+        return false;
+    }
+    // Stdout carries the logs, so the benchmark report needs a file.
+    if (opt.bench && opt.output.empty()) {
+        return false;
+    }
+    return opt.frames > 0 && opt.adaptiveThreshold >= 0 && opt.resolution.x > 0 && opt.resolution.y > 0 && opt.bounces >= 0;
+}
@@ -0,0 +1,69 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include "glm/glm.hpp"
+#include "util.h"
+
+struct Options {
+    bool cpu = false;
+    bool headless = false;
+    // Renders the fixed benchmark cases (see Benchmark.h) instead of --scene.
+    bool bench = false;
+    // Compares per-frame buffer upload paths instead of rendering.
+    bool benchUpload = false;
+    std::string scene = "scene3";
+    u32 frames = 16;
+    glm::ivec2 resolution = glm::ivec2(1920, 1280);
+    u32 threads = 0;
+    // Overrides the scene's bounce count when non-zero.
+    i32 bounces = 0;
+    bool lightSampling = true;
+    bool roulette = true;
+    // World::Sampler of the GPU kernel.
+    i32 sampler = 0;
+    // Always runs the kernel that handles every scene feature instead of
+    // the variant built for the scene.
+    bool uberKernel = false;
+    // Traces with the wavefront passes instead of the megakernel, see
+    // Wavefront.h.
+    bool wavefront = false;
+    // Groups the wavefront's hits by material before shading; implies
+    // wavefront.
+    bool sortMaterials = false;
+    // Rasterizes primary visibility instead of tracing it, see
+    // PrimaryRaster.h.
+    bool rasterPrimary = false;
+    // Uploads spheres and quads in the packed layout, see
+    // World::setPackedPrimitives().
+    bool packedPrimitives = false;
+    // Relative standard error at which a pixel stops taking samples, 0 to
+    // sample every pixel every frame; see pixelConverged() in raytrace.comp.
+    f32 adaptiveThreshold = 0;
+    // Draws the frames each pixel took instead of the image.
+    bool sampleHeatmap = false;
+    // Filters the image with the à-trous denoiser, see Denoiser.h.
+    bool denoise = false;
+    // Reprojects the accumulation when the camera moves instead of
+    // restarting it.
+    bool temporal = true;
+    // Headless: degrees the camera turns every frame after the first.
+    f32 pan = 0;
+    // OBJ file added to the scene, see loadMeshFile().
+    std::string mesh;
+    // Binary scene cache, see SceneCache.h. Written when missing or stale.
+    std::string cache;
+    // Linked shader programs, see gl::ShaderProgram::set_binary_cache().
+    // Empty disables it.
+    std::string shaderCache = "shaders/cache";
+    // Per-frame GPU pass times as CSV, see gl::GpuProfiler.
+    std::string profile;
+    // .pfm keeps the linear accumulation, .png the tone-mapped screen.
+    // With --bench the JSON report goes here; it is required then.
+    std::string output;
+};
+
+bool parseOptions(int argc, char** argv, Options& opt);
+void printUsage(const char* program);
+
+#endif
@@ -0,0 +1,148 @@
+#include "PrimaryRaster.h"
+#include <cmath>
+#include <vector>
+#include "glad/glad.h"
+#include "OpenGL/Renderer.h"
+#include "OpenGL/VertexBufferLayout.h"
+
+#define SHADER_SOURCE_DIRECTORY "shaders/"
+
+// Vertex layout of primary.vert.
+struct RasterVertex {
+    glm::vec4 position;
+    glm::vec3 axis;
+    f32 ref;
+};
+
+static_assert(sizeof(RasterVertex) == 32, "RasterVertex must match the attributes of primary.vert");
+
+PrimaryRaster::PrimaryRaster()
+    : m_geometryDirty(true), m_resolution(0)
+{}
+
+void PrimaryRaster::build(const World& world) {
+    const std::vector<Sphere>& spheres = world.getSpheres();
+    const std::vector<Quad>& quads = world.getQuads();
+    std::vector<RasterVertex> vertices;
+    std::vector<u32> indices;
+    vertices.reserve((spheres.size() + quads.size()) * 4);
+    indices.reserve((spheres.size() + quads.size()) * 6);
+
+    // References are exact as floats up to 2^24.
+    static const glm::vec2 corners[4] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    for (u32 i = 0; i < spheres.size(); ++i) {
+        const f32 ref = (f32)((i << 1) | World::PRIMITIVE_SPHERE);
+        for (const glm::vec2& corner : corners) {
+            vertices.push_back({ glm::vec4(spheres[i].center, spheres[i].radius), glm::vec3(corner.x, corner.y, 0), ref });
+        }
+    }
+    for (u32 i = 0; i < quads.size(); ++i) {
+        const Quad& quad = quads[i];
+        const f32 ref = (f32)((i << 1) | World::PRIMITIVE_QUAD);
+        const glm::vec3 normal = glm::cross(quad.u, quad.v);
+        vertices.push_back({ glm::vec4(quad.q, 0), normal, ref });
+        vertices.push_back({ glm::vec4(quad.q + quad.u, 0), normal, ref });
+        vertices.push_back({ glm::vec4(quad.q + quad.u + quad.v, 0), normal, ref });
+        vertices.push_back({ glm::vec4(quad.q + quad.v, 0), normal, ref });
+    }
+    for (u32 base = 0; base < vertices.size(); base += 4) {
+        const u32 quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+        indices.insert(indices.end(), quad, quad + 6);
+    }
+
+    m_vao.reset();
+    m_vertices.reset();
+    m_indices.reset();
+    m_geometryDirty = false;
+    if (indices.empty()) {
+        return;
+    }
+    m_vao.reset(new gl::VertexArray());
+    m_vertices.reset(new gl::VertexBuffer(vertices.data(), (u32)(vertices.size() * sizeof(RasterVertex))));
+    m_indices.reset(new gl::IndexBuffer(indices.data(), (u32)indices.size()));
+    gl::VertexBufferLayout layout;
+    layout.add<f32>(4);
+    layout.add<f32>(3);
+    layout.add<f32>(1);
+    m_vao->apply_buffer_layout(layout);
+    m_vao->unbind();
+}
+
+void PrimaryRaster::render(const World& world, const World::Camera& cam, const glm::ivec2& resolution,
+        const glm::vec2& jitter, gl::GpuProfiler& profiler) {
+    if (!m_shader) {
+        m_shader.reset(new gl::ShaderProgram());
+        m_shader->attach_shader(GL_VERTEX_SHADER, SHADER_SOURCE_DIRECTORY "primary.vert");
+        m_shader->attach_shader(GL_FRAGMENT_SHADER, SHADER_SOURCE_DIRECTORY "primary.frag");
+        m_shader->link();
+        m_cameraPosition = m_shader->get_uniform<glm::vec3>("cameraPosition");
+        m_cameraForward = m_shader->get_uniform<glm::vec3>("cameraForward");
+        m_cameraRight = m_shader->get_uniform<glm::vec3>("cameraRight");
+        m_cameraUp = m_shader->get_uniform<glm::vec3>("cameraUp");
+        m_viewportScale = m_shader->get_uniform<glm::vec2>("viewportScale");
+        m_viewportOffset = m_shader->get_uniform<glm::vec2>("viewportOffset");
+    }
+    if (m_geometryDirty) {
+        build(world);
+    }
+    if (!m_fbo || m_resolution != resolution) {
+        m_fbo.reset();
+        m_refs.reset(new gl::Texture2D(resolution.x, resolution.y, GL_R32I, GL_RED_INTEGER, GL_INT,
+                    GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST));
+        m_depth.reset(new gl::Texture2D(resolution.x, resolution.y, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT,
+                    GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST));
+        m_fbo.reset(new gl::FrameBufferObject(*m_refs));
+        m_fbo->bindDepth(*m_depth);
+        m_resolution = resolution;
+    }
+
+    // The viewport of raytrace.comp's viewportPoint(), one unit in front of
+    // the camera; cameraRay() offsets a pixel's samples by up to one
+    // 1/resolution step along right and up.
+    const f32 viewportHeight = 2.0f * std::tan(glm::radians(cam.fov) * 0.5f);
+    const glm::vec2 viewport(viewportHeight * resolution.x / resolution.y, viewportHeight);
+    const glm::vec2 scale = 2.0f / viewport;
+    const glm::vec2 rResolution = 1.0f / glm::vec2(resolution);
+
+    m_fbo->bind();
+    GLCALL(glViewport(0, 0, resolution.x, resolution.y));
+    const i32 noRef = -1;
+    const f32 farthest = 0;
+    GLCALL(glClearBufferiv(GL_COLOR, 0, &noRef));
+    GLCALL(glClearBufferfv(GL_DEPTH, 0, &farthest));
+
+    profiler.begin("raster");
+    if (m_vao) {
+        GLCALL(glEnable(GL_DEPTH_TEST));
+        GLCALL(glDepthFunc(GL_GREATER));
+        m_shader->bind();
+        m_shader->set(m_cameraPosition, cam.pos);
+        m_shader->set(m_cameraForward, cam.forward);
+        m_shader->set(m_cameraRight, cam.right);
+        m_shader->set(m_cameraUp, cam.up);
+        m_shader->set(m_viewportScale, scale);
+        m_shader->set(m_viewportOffset, rResolution * (glm::vec2(1) - jitter * scale));
+        m_vao->bind();
+        GLCALL(glDrawElements(GL_TRIANGLES, m_indices->count(), GL_UNSIGNED_INT, 0));
+        m_vao->unbind();
+        GLCALL(glDepthFunc(GL_LESS));
+        GLCALL(glDisable(GL_DEPTH_TEST));
+    }
+    profiler.end();
+    m_fbo->unbind();
+}
+
+void PrimaryRaster::bindRefs(u32 slot) const {
+    m_refs->bind(slot);
+}
+
+void PrimaryRaster::release() {
+    m_shader.reset();
+    m_vao.reset();
+    m_vertices.reset();
+    m_indices.reset();
+    m_fbo.reset();
+    m_refs.reset();
+    m_depth.reset();
+    m_geometryDirty = true;
+}
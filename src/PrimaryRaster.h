@@ -0,0 +1,59 @@
+#ifndef PRIMARY_RASTER_H
+#define PRIMARY_RASTER_H
+
+#include <memory>
+#include "OpenGL/ShaderProgram.h"
+#include "OpenGL/VertexArray.h"
+#include "OpenGL/VertexBuffer.h"
+#include "OpenGL/IndexBuffer.h"
+#include "OpenGL/Texture2D.h"
+#include "OpenGL/FrameBufferObject.h"
+#include "OpenGL/GpuProfiler.h"
+#include "World.h"
+#include "util.h"
+
+// Rasterizes primary visibility instead of tracing it: every sphere (as a
+// camera-facing impostor) and quad is drawn into a visibility buffer that
+// holds, per pixel, the reference of the primitive the camera ray through
+// the frame's jittered sample point hits first, or -1. raytrace.comp then
+// intersects that one primitive to start the pixel's paths (primaryHit())
+// instead of traversing the BVH. Meshes are not drawn; the kernel still
+// traces them against the rasterized hit.
+class PrimaryRaster {
+private:
+    std::unique_ptr<gl::ShaderProgram> m_shader;
+    gl::Uniform<glm::vec3> m_cameraPosition, m_cameraForward, m_cameraRight, m_cameraUp;
+    gl::Uniform<glm::vec2> m_viewportScale, m_viewportOffset;
+
+    // Four vertices and six indices per primitive, built from the world
+    // by the first render() after invalidate().
+    std::unique_ptr<gl::VertexArray> m_vao;
+    std::unique_ptr<gl::VertexBuffer> m_vertices;
+    std::unique_ptr<gl::IndexBuffer> m_indices;
+    bool m_geometryDirty;
+
+    glm::ivec2 m_resolution;
+    std::unique_ptr<gl::Texture2D> m_refs;
+    std::unique_ptr<gl::Texture2D> m_depth;
+    std::unique_ptr<gl::FrameBufferObject> m_fbo;
+
+    void build(const World& world);
+
+public:
+    PrimaryRaster();
+
+    // Draws the view of `cam` at `resolution`, with the samples at `jitter`
+    // (in [0, 1)^2) of every pixel as cameraRay() places them. The pass
+    // time goes to `profiler` as "raster".
+    void render(const World& world, const World::Camera& cam, const glm::ivec2& resolution, const glm::vec2& jitter,
+            gl::GpuProfiler& profiler);
+    // Binds the visibility buffer, an R32I texture, to texture unit `slot`.
+    void bindRefs(u32 slot) const;
+    // Call after the world's spheres or quads changed.
+    inline void invalidate() { m_geometryDirty = true; }
+    // Deletes the GL objects; call while the context is current.
+    void release();
+
+};
+
+#endif
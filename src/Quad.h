@@ -18,4 +18,19 @@ struct Quad {
     int aabbIndex;
 };
 
+// Quad as raytrace.comp reads it with PACKED_PRIMITIVES: the corner and
+// both edges in three 16-byte loads, instead of Quad's 64 std430 bytes;
+// the material index lives in World's primitive material list.
+struct PackedQuad {
+    PackedQuad() = default;
+    explicit PackedQuad(const Quad& quad)
+        : q(quad.q, 0), u(quad.u, 0), v(quad.v, 0)
+    {}
+
+    glm::vec4 q, u, v;
+};
+
+static_assert(sizeof(Quad) == 64, "Quad must match the std430 layout in raytrace.comp");
+static_assert(sizeof(PackedQuad) == 48, "PackedQuad must match the packed layout in raytrace.comp");
+
 #endif
@@ -0,0 +1,344 @@
+#include "SceneCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+enum CacheSection {
+    SECTION_AABBS,
+    SECTION_MATERIALS,
+    SECTION_SPHERES,
+    SECTION_QUADS,
+    SECTION_BVH_NODES,
+    SECTION_BVH_PRIMS,
+    SECTION_MESH_POSITIONS,
+    SECTION_MESH_NORMALS,
+    SECTION_MESH_TRIANGLES,
+    SECTION_MESH_NODES,
+    SECTION_COUNT,
+};
+
+// Section offsets are aligned to this, which keeps every mapped section
+// aligned for the 16-byte std430 structs.
+static const u64 SECTION_ALIGNMENT = 64;
+
+struct CacheHeader {
+    char magic[4];
+    u32 version;
+    // Struct sizes the sections were written with.
+    u32 aabbSize, materialSize, sphereSize, quadSize, nodeSize;
+    char key[256];
+
+    f32 skyColor[3];
+    f32 exposure, gamma;
+    f32 camPos[3];
+    f32 camYaw, camPitch, camFov;
+    i32 camBounces, camRayPerPixel;
+    u32 objectCount, objectAABBCount;
+    // Instance records at the end of the mesh triangles.
+    u32 instanceCount;
+
+    BVH::Stats bvhStats, meshBVHStats, instanceBVHStats;
+
+    struct {
+        u64 offset, size;
+    } sections[SECTION_COUNT];
+};
+
+static const char CACHE_MAGIC[4] = { 'R', 'T', 'S', 'C' };
+
+static void fillLayout(CacheHeader& header) {
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = SCENE_CACHE_VERSION;
+    header.aabbSize = sizeof(AABB);
+    header.materialSize = sizeof(Material);
+    header.sphereSize = sizeof(Sphere);
+    header.quadSize = sizeof(Quad);
+    header.nodeSize = sizeof(BVHNode);
+}
+
+bool writeSceneCache(const std::string& path, const std::string& key, World& world) {
+    if (key.size() >= sizeof(CacheHeader::key)) {
+        return false;
+    }
+    world.build();
+
+    // Value-initialised so padding and the unused key bytes are zero.
+    CacheHeader header = CacheHeader();
+    fillLayout(header);
+    memcpy(header.key, key.c_str(), key.size());
+
+    memcpy(header.skyColor, &world.skyColor.x, sizeof(header.skyColor));
+    header.exposure = world.exposure;
+    header.gamma = world.gamma;
+    memcpy(header.camPos, &world.cam.pos.x, sizeof(header.camPos));
+    header.camYaw = world.cam.yaw;
+    header.camPitch = world.cam.pitch;
+    header.camFov = world.cam.fov;
+    header.camBounces = world.cam.bounces;
+    header.camRayPerPixel = world.cam.rayPerPixel;
+    header.objectCount = world.objectCount;
+    header.objectAABBCount = world.objectAABBCount;
+    header.bvhStats = world.bvh.stats;
+    header.meshBVHStats = world.meshBVH.stats;
+    header.instanceCount = world.instanceCount;
+    header.instanceBVHStats = world.instanceBVH.stats;
+
+    const void* data[SECTION_COUNT] = {
+        world.aabbBoxes.data(),
+        world.materials.data(),
+        world.spheres.data(),
+        world.quads.data(),
+        world.bvh.nodes.data(),
+        world.primitiveRefs.data(),
+        world.meshPositionView.data(),
+        world.meshNormalView.data(),
+        world.meshTriangleView.data(),
+        world.meshNodeView.data(),
+    };
+    const u64 sizes[SECTION_COUNT] = {
+        world.aabbBoxes.size() * sizeof(AABB),
+        world.materials.size() * sizeof(Material),
+        world.spheres.size() * sizeof(Sphere),
+        world.quads.size() * sizeof(Quad),
+        world.bvh.nodes.size() * sizeof(BVHNode),
+        world.primitiveRefs.size() * sizeof(i32),
+        world.meshPositionView.size() * sizeof(f32),
+        world.meshNormalView.size() * sizeof(u32),
+        world.meshTriangleView.size() * sizeof(glm::uvec4),
+        world.meshNodeView.size() * sizeof(BVHNode),
+    };
+
+    u64 offset = sizeof(CacheHeader);
+    for (u32 i = 0; i < SECTION_COUNT; ++i) {
+        offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset += sizes[i];
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    static const u8 zeros[SECTION_ALIGNMENT] = {};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    u64 written = sizeof(header);
+    for (u32 i = 0; i < SECTION_COUNT && ok; ++i) {
+        ok = fwrite(zeros, 1, header.sections[i].offset - written, file) == header.sections[i].offset - written;
+        if (ok && sizes[i] > 0) {
+            ok = fwrite(data[i], 1, sizes[i], file) == sizes[i];
+        }
+        written = header.sections[i].offset + sizes[i];
+    }
+
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(path.c_str());
+    }
+    return ok;
+}
+
+// Returns the section as `count` elements of T, or false when it does not
+// fit the file or is not a whole number of elements.
+template <typename T>
+static bool section(const MappedFile& file, const CacheHeader& header, CacheSection id, const T*& ptr, size_t& count) {
+    const u64 offset = header.sections[id].offset;
+    const u64 size = header.sections[id].size;
+    if (offset % SECTION_ALIGNMENT != 0 || offset > file.size() || size > file.size() - offset || size % sizeof(T) != 0) {
+        return false;
+    }
+    ptr = (const T*)(file.data() + offset);
+    count = (size_t)(size / sizeof(T));
+    return true;
+}
+
+template <typename T>
+static bool copySection(const MappedFile& file, const CacheHeader& header, CacheSection id, std::vector<T>& out) {
+    const T* ptr;
+    size_t count;
+    if (!section(file, header, id, ptr, count)) {
+        return false;
+    }
+    out.assign(ptr, ptr + count);
+    return true;
+}
+
+template <typename T>
+static bool viewSection(const MappedFile& file, const CacheHeader& header, CacheSection id, ArrayView<T>& out) {
+    const T* ptr;
+    size_t count;
+    if (!section(file, header, id, ptr, count)) {
+        return false;
+    }
+    out = ArrayView<T>(ptr, count);
+    return true;
+}
+
+// Whether every link of a hierarchy stays inside the arrays it indexes:
+// children follow their parent (so walks terminate) and no path is deeper
+// than the traversal stacks hold; leaves index `primCount` primitives, or
+// with a negative count, that many records of `recordSize` entries in
+// [primCount, entryCount).
+static bool validTree(const ArrayView<BVHNode>& nodes, u64 primCount, u64 entryCount, u64 recordSize) {
+    std::vector<u32> depth(nodes.size(), 1);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const BVHNode& node = nodes[i];
+        if (node.leftFirst < 0) {
+            return false;
+        }
+        const u64 first = (u64)node.leftFirst;
+        if (node.count == 0) {
+            if (first <= i || first + 1 >= nodes.size() || depth[i] >= BVH::STACK_SIZE) {
+                return false;
+            }
+            depth[first] = std::max(depth[first], depth[i] + 1);
+            depth[first + 1] = std::max(depth[first + 1], depth[i] + 1);
+        }
+        else if (node.count > 0) {
+            if (first + (u64)node.count > primCount) {
+                return false;
+            }
+        }
+        else if (recordSize == 0 || first < primCount
+                || first + (u64)-(i64)node.count * recordSize > entryCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks what the tracers index through without bounds checks: node
+// links, primitive references, triangle vertices, instance roots and
+// material indices.
+static bool validateWorld(const World& world, u32 instanceCount) {
+    const u64 materialCount = world.getMaterials().size();
+    for (const Sphere& sphere : world.getSpheres()) {
+        if (sphere.materialIndex < 0 || (u64)sphere.materialIndex >= materialCount) {
+            return false;
+        }
+    }
+    for (const Quad& quad : world.getQuads()) {
+        if (quad.materialIndex < 0 || (u64)quad.materialIndex >= materialCount) {
+            return false;
+        }
+    }
+    const std::vector<i32>& refs = world.getPrimitiveRefs();
+    for (i32 ref : refs) {
+        const u64 count = (ref & 1) == World::PRIMITIVE_SPHERE ? world.getSpheres().size() : world.getQuads().size();
+        if (ref < 0 || (u64)(ref >> 1) >= count) {
+            return false;
+        }
+    }
+    if (!validTree(world.getBVH().nodes, refs.size(), refs.size(), 0)) {
+        return false;
+    }
+
+    const ArrayView<glm::uvec4> triangles = world.getMeshTriangles();
+    const ArrayView<BVHNode> nodes = world.getMeshNodes();
+    const u64 vertexCount = world.getMeshNormals().size();
+    const u64 recordSize = sizeof(InstanceRecord) / sizeof(glm::uvec4);
+    if (world.getMeshPositions().size() != vertexCount * 3 || (u64)instanceCount * recordSize > triangles.size()) {
+        return false;
+    }
+    const u64 triangleCount = triangles.size() - (u64)instanceCount * recordSize;
+    for (u64 i = 0; i < triangleCount; ++i) {
+        const glm::uvec4& tri = triangles[i];
+        if (tri.x >= vertexCount || tri.y >= vertexCount || tri.z >= vertexCount || tri.w >= materialCount) {
+            return false;
+        }
+    }
+    for (u64 i = 0; i < instanceCount; ++i) {
+        InstanceRecord record;
+        memcpy((void*)&record, &triangles[triangleCount + i * recordSize], sizeof(record));
+        if (record.root >= nodes.size() || record.material >= materialCount) {
+            return false;
+        }
+    }
+    return validTree(nodes, triangleCount, triangles.size(), instanceCount > 0 ? recordSize : 0);
+}
+
+bool loadSceneCache(const std::string& path, const std::string& key, World& world) {
+    MappedFile& file = world.cacheFile;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    CacheHeader expected = CacheHeader();
+    fillLayout(expected);
+
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    header.key[sizeof(header.key) - 1] = '\0';
+
+    if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            || header.version != expected.version
+            || header.aabbSize != expected.aabbSize
+            || header.materialSize != expected.materialSize
+            || header.sphereSize != expected.sphereSize
+            || header.quadSize != expected.quadSize
+            || header.nodeSize != expected.nodeSize
+            || key != header.key) {
+        file.close();
+        return false;
+    }
+
+    // The small arrays are edited (materials) or rebuilt from (lights) at
+    // runtime, so they are copied; meshes stay in the mapping.
+    bool ok = copySection(file, header, SECTION_AABBS, world.aabbBoxes)
+        && copySection(file, header, SECTION_MATERIALS, world.materials)
+        && copySection(file, header, SECTION_SPHERES, world.spheres)
+        && copySection(file, header, SECTION_QUADS, world.quads)
+        && copySection(file, header, SECTION_BVH_NODES, world.bvh.nodes)
+        && copySection(file, header, SECTION_BVH_PRIMS, world.primitiveRefs)
+        && viewSection(file, header, SECTION_MESH_POSITIONS, world.meshPositionView)
+        && viewSection(file, header, SECTION_MESH_NORMALS, world.meshNormalView)
+        && viewSection(file, header, SECTION_MESH_TRIANGLES, world.meshTriangleView)
+        && viewSection(file, header, SECTION_MESH_NODES, world.meshNodeView);
+    // The mapping may be truncated or edited since it was written, so a
+    // bad link fails the load instead of the trace.
+    ok = ok && validateWorld(world, header.instanceCount);
+    // The spheres and quads were replaced, or cleared below.
+    ++world.geometryRevision;
+    if (!ok) {
+        file.close();
+        world.aabbBoxes.clear();
+        world.materials.clear();
+        world.spheres.clear();
+        world.quads.clear();
+        world.bvh.clear();
+        world.primitiveRefs.clear();
+        world.refreshMeshViews();
+        world.refreshMaterialFeatures();
+        return false;
+    }
+
+    world.skyColor = glm::vec3(header.skyColor[0], header.skyColor[1], header.skyColor[2]);
+    world.exposure = header.exposure;
+    world.gamma = header.gamma;
+    world.cam.pos = glm::vec3(header.camPos[0], header.camPos[1], header.camPos[2]);
+    world.cam.yaw = header.camYaw;
+    world.cam.pitch = header.camPitch;
+    world.cam.fov = header.camFov;
+    world.cam.bounces = header.camBounces;
+    world.cam.rayPerPixel = header.camRayPerPixel;
+    world.objectCount = header.objectCount;
+    world.objectAABBCount = header.objectAABBCount;
+    world.instanceCount = header.instanceCount;
+    world.refreshMaterialFeatures();
+
+    // Nothing was built this run.
+    world.bvh.stats = header.bvhStats;
+    world.bvh.stats.buildMs = 0;
+    world.meshBVH.stats = header.meshBVHStats;
+    world.meshBVH.stats.buildMs = 0;
+    world.instanceBVH.stats = header.instanceBVHStats;
+    world.instanceBVH.stats.buildMs = 0;
+    world.bvhDirty = false;
+    world.meshBVHDirty = false;
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <string>
+#include "World.h"
+
+// Binary snapshot of a built World: settings, materials, primitives and
+// every hierarchy, each section stored in the std430 layout raytrace.comp
+// reads. Loading maps the file; the mesh sections are uploaded (and traced
+// on the CPU) straight from the mapping, the small editable arrays are
+// copied. `key` names what the cache was built from; a cache with another
+// key, version or struct layout is refused.
+static const u32 SCENE_CACHE_VERSION = 2;
+
+// Builds the world's hierarchies if needed and writes the snapshot.
+bool writeSceneCache(const std::string& path, const std::string& key, World& world);
+
+// Fills an empty world from the cache. Geometry must not be added afterwards.
+bool loadSceneCache(const std::string& path, const std::string& key, World& world);
+
+#endif
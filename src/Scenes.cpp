@@ -0,0 +1,426 @@
+#include "Scenes.h"
+#include "SceneCache.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <sys/stat.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+void loadCornellBox(World* world, const glm::vec3& pos, float boxLen, float lightLen) {
+    glm::vec3 red = glm::vec3(.65, .05, .05);
+    glm::vec3 green = glm::vec3(.12, .45, .15);
+    glm::vec3 white = glm::vec3(1.0, 1.0, 1.0);
+
+    Material m;
+    m.roughness = 1.0;
+    m.albedo = glm::vec3(0);
+    m.emissionColor = {1, 1, 1};
+    m.emissionStrength = 20;
+
+    world->add<Quad>(
+            { {pos.x + boxLen * 0.5 + lightLen * 0.5, pos.y + boxLen - 0.000001, pos.z - lightLen * 0.5 - lightLen}, {-lightLen, 0, 0}, {0, 0, -lightLen} },
+            m, false 
+        );
+
+    m.emissionColor = {0, 0, 0};
+    m.emissionStrength = 0;
+ 
+    m.albedo = white;
+    world->add<Quad>(
+            { {pos.x, pos.y, pos.z}, {boxLen, 0, 0}, {0, 0, -boxLen} },
+            m, false 
+        );
+
+    world->add<Quad>(
+            { {pos.x + boxLen, pos.y + boxLen, pos.z}, {-boxLen, 0, 0}, {0, 0, -boxLen} },
+            m, false 
+        );
+
+    world->add<Quad>(
+            { {pos.x + boxLen, pos.y, pos.z}, {-boxLen, 0, 0}, {0, boxLen, 0} },
+            m, false 
+        );
+
+    world->add<Quad>(
+            { {pos.x, pos.y, pos.z - boxLen}, {boxLen, 0, 0}, {0, boxLen, 0} },
+            m, false 
+        );
+
+    m.albedo = red;
+    world->add<Quad>(
+            { {pos.x, pos.y, pos.z - boxLen}, {0, boxLen, 0}, {0, 0, boxLen} },
+            m, false 
+        );
+
+    m.albedo = green;
+    world->add<Quad>(
+            { {pos.x + boxLen, pos.y, pos.z}, {0, boxLen, 0}, {0, 0, -boxLen} },
+            m, false 
+        );
+}
+
+void loadBox(World* world, glm::vec2 len, glm::vec3 pos, float degree) {
+    glm::mat3 r = glm::rotate(glm::mat4(1), glm::radians(degree), {0, 1, 0});
+
+    glm::vec3 b1Vertex[] = {
+        glm::vec3{len.x, 0, len.x} * 0.5f * r,
+        glm::vec3{-len.x, 0, len.x} * 0.5f * r,
+        glm::vec3{-len.x, 0, -len.x} * 0.5f * r,
+        glm::vec3{len.x, 0, -len.x} * 0.5f * r,
+        glm::vec3{len.x, len.y * 2.0f, len.x} * 0.5f * r,
+        glm::vec3{-len.x, len.y * 2.0f, len.x} * 0.5f * r,
+        glm::vec3{-len.x, len.y * 2.0f, -len.x} * 0.5f * r,
+        glm::vec3{len.x, len.y * 2.0f, -len.x} * 0.5f * r,
+    };
+
+    Material m;
+    m.roughness = 1;
+    m.albedo = glm::vec3(1);
+    world->add<Quad>(
+            { pos + b1Vertex[0], b1Vertex[4] - b1Vertex[0], b1Vertex[1] - b1Vertex[0]},
+            m, false
+        );
+
+    world->add<Quad>(
+            { pos + b1Vertex[1], b1Vertex[5] - b1Vertex[1], b1Vertex[2] - b1Vertex[1]},
+            m, false 
+        );
+
+    world->add<Quad>(
+            { pos + b1Vertex[2], b1Vertex[6] - b1Vertex[2], b1Vertex[3] - b1Vertex[2] },
+            m, false 
+        );
+
+    world->add<Quad>(
+            { pos + b1Vertex[3], b1Vertex[7] - b1Vertex[3], b1Vertex[0] - b1Vertex[3] },
+            m, false 
+        );
+
+    world->add<Quad>(
+            { pos + b1Vertex[4], b1Vertex[3] - b1Vertex[0], b1Vertex[1] - b1Vertex[0]},
+            m, false 
+        );
+}
+
+void loadScene1(World* world) {
+    Material m;
+    m.roughness = 1;
+    m.albedo = {0.7, 0.7, 0.7};
+    world->add<Sphere>(
+            { 50, {0, -50 - 0.2, 1.2}, 0 },
+            m, false
+        );
+    
+    m.emissionColor = {1, 1, 1};
+    m.emissionStrength = 30;
+    m.albedo = {0, 0, 0};
+    world->add<Sphere>(
+            { 1, {0, 3, 15}, 1 },
+            m, false
+        );
+    m.emissionColor = {0, 0, 0};
+    m.emissionStrength = 0;
+
+    m.albedo = {0.6, 0.3, 0.5};
+    world->add<Sphere>(
+            { 0.2, {0, 0, 1.2}, 2 },
+            m, false
+        );
+
+    m.albedo = {0.3, 0.8, 0.5};
+    world->add<Sphere>(
+            { 0.2, {0.5, 0, 1.2}, 2 },
+            m, false
+        );
+}
+
+void loadScene2(World* world) {
+    float boxLen = 3;
+    float lightLen = 0.9;
+    glm::vec3 pos = {-boxLen * 0.5, -boxLen * 0.5, 2 * boxLen};
+    glm::vec3 center = pos + glm::vec3{boxLen, 0, -boxLen} * 0.5f;
+    loadCornellBox(world, pos, boxLen, lightLen);
+
+    Material m;
+    m.roughness = 1;
+    m.albedo = {1, 1, 1};
+
+    world->add<Sphere>(
+            { 0.5, center + glm::vec3{0, 1, 0}, 2 },
+            m, false
+        );
+}
+
+void loadScene3(World* world) {
+    world->skyColor = { 0.0, 0.0, 0.0 };
+    world->cam.fov = 54;
+
+    float boxLen = 4;
+    float lightLen = 1.2;
+    glm::vec3 pos = {-boxLen * 0.5, -2, 2 * boxLen};
+    loadCornellBox(world, pos, boxLen, lightLen);
+
+    glm::vec2 b1Len = {1.2, 2.4};
+    glm::vec3 b1Pos = {1.2, 0, 1.3};
+    glm::vec3 b2Pos = {2.64, 0, 2.5};
+    loadBox(world, b1Len, {pos.x + b1Pos.x, pos.y + b1Pos.y, pos.z - b1Pos.z}, 18);
+    loadBox(world, {1.15, 1.15}, {pos.x + b2Pos.x, pos.y + b2Pos.y, pos.z - b2Pos.z}, -18);
+}
+
+void RoughnessMetallicTest(World *world) {
+    Material m;
+    m.roughness = 1.0;
+    int groundLen = 10;
+    world->add<Quad>(
+            { {groundLen * 0.5, -0.1 - 1, groundLen * 0.5}, {0, 0, -groundLen}, {-groundLen, 0, 0} }, m, false );
+
+    glm::vec3 red = glm::vec3(.65, .05, .05);
+    m.albedo = red;
+    m.specular = 1;
+    for (int i = 0; i <= 10; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            m.roughness = i / 10.0;
+            m.metallic = j * (1 - i / 10.0);
+            world->add<Sphere>(
+                    { 0.1, {i * 0.3 - groundLen * 0.5 * 0.3, -1, 2 - j * 0.5} }, m, false);
+        }
+    }
+
+    m.emissionColor = {1, 1, 1};
+    m.emissionStrength = 300;
+    m.albedo = {0, 0, 0};
+    world->add<Sphere>(
+            { 1, {-5, 8, -15}, 1 },
+            m, false
+        );
+    m.emissionColor = {0, 0, 0};
+    m.emissionStrength = 0;
+}
+
+void BoxGridTest(World* world) {
+    Material m;
+    m.roughness = 1.0;
+    float groundLen = 12;
+    world->add<Quad>(
+            { {groundLen * 0.5f, -1, groundLen * 0.5f + 6}, {0, 0, -groundLen}, {-groundLen, 0, 0} }, m, false );
+
+    // 20x20 boxes of varying height: 2000 quads, most of them off the path
+    // of any given ray.
+    const int gridLen = 20;
+    for (int i = 0; i < gridLen; ++i) {
+        for (int j = 0; j < gridLen; ++j) {
+            float height = 0.1f + 0.4f * ((i * 7 + j * 13) % 10) / 10.0f;
+            glm::vec3 pos = { (i - gridLen * 0.5f) * 0.5f, -1, 2 + j * 0.5f };
+            loadBox(world, {0.25, height}, pos, (i * 31 + j * 17) % 90);
+        }
+    }
+
+    m.emissionColor = {1, 1, 1};
+    m.emissionStrength = 300;
+    m.albedo = {0, 0, 0};
+    world->add<Sphere>(
+            { 1, {-5, 8, -15}, 1 },
+            m, false
+        );
+}
+
+// Latitude/longitude sphere with smooth normals.
+static Mesh createUVSphere(const glm::vec3& center, float radius, u32 segments, u32 rings) {
+    Mesh mesh;
+    for (u32 r = 0; r <= rings; ++r) {
+        float theta = glm::radians(180.0f * r / rings);
+        for (u32 s = 0; s <= segments; ++s) {
+            float phi = glm::radians(360.0f * s / segments);
+            glm::vec3 n = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+            mesh.positions.push_back(center + n * radius);
+            mesh.normals.push_back(n);
+        }
+    }
+
+    for (u32 r = 0; r < rings; ++r) {
+        for (u32 s = 0; s < segments; ++s) {
+            u32 a = r * (segments + 1) + s;
+            u32 b = a + segments + 1;
+            if (r != 0) {
+                mesh.indices.insert(mesh.indices.end(), { a, a + 1, b });
+            }
+            if (r != rings - 1) {
+                mesh.indices.insert(mesh.indices.end(), { a + 1, b + 1, b });
+            }
+        }
+    }
+    return mesh;
+}
+
+void MeshTest(World* world) {
+    world->skyColor = { 0.0, 0.0, 0.0 };
+    world->cam.fov = 54;
+
+    float boxLen = 4;
+    glm::vec3 pos = {-boxLen * 0.5, -2, 2 * boxLen};
+    loadCornellBox(world, pos, boxLen, 1.2);
+
+    // A coarse sphere shows the normal interpolation, a fine one (~260k
+    // triangles) exercises the triangle hierarchy.
+    Material m;
+    m.roughness = 1;
+    m.albedo = {0.9, 0.9, 0.9};
+    world->add<Mesh>(createUVSphere({-0.9, -1.3, 6.5}, 0.7, 12, 6), m);
+
+    m.roughness = 0.3;
+    m.metallic = 1;
+    m.albedo = {0.95, 0.64, 0.54};
+    world->add<Mesh>(createUVSphere({0.9, -1.3, 5.5}, 0.7, 512, 256), m);
+}
+
+// Unit cube around the origin with flat faces.
+static Mesh createCube() {
+    Mesh mesh;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        for (int side = -1; side <= 1; side += 2) {
+            glm::vec3 n(0), u(0), v(0);
+            n[axis] = (float)side;
+            u[(axis + 1) % 3] = 0.5f;
+            v[(axis + 2) % 3] = 0.5f;
+            const u32 base = (u32)mesh.positions.size();
+            mesh.positions.push_back(n * 0.5f - u - v);
+            mesh.positions.push_back(n * 0.5f + u - v);
+            mesh.positions.push_back(n * 0.5f + u + v);
+            mesh.positions.push_back(n * 0.5f - u + v);
+            mesh.normals.insert(mesh.normals.end(), 4, n);
+            mesh.indices.insert(mesh.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+        }
+    }
+    return mesh;
+}
+
+void InstanceGridTest(World* world) {
+    Material m;
+    m.roughness = 1.0;
+    float groundLen = 24;
+    world->add<Quad>(
+            { {groundLen * 0.5f, -1, groundLen + 1}, {0, 0, -groundLen}, {-groundLen, 0, 0} }, m, false );
+
+    // 64x64 cubes and ellipsoids (~550 triangles) of varying size: two
+    // shapes and four materials stored once, placed 4096 times.
+    const u32 cube = world->addShape(createCube());
+    const u32 sphere = world->addShape(createUVSphere({0, 0, 0}, 0.5, 24, 12));
+    const glm::vec3 colors[4] = { {0.8, 0.8, 0.8}, {0.65, 0.05, 0.05}, {0.12, 0.45, 0.15}, {0.9, 0.6, 0.2} };
+    u32 materials[4];
+    for (u32 i = 0; i < 4; ++i) {
+        m.albedo = colors[i];
+        m.roughness = i == 3 ? 0.3f : 1.0f;
+        m.metallic = i == 3 ? 1.0f : 0.0f;
+        materials[i] = world->addMaterial(m);
+    }
+
+    const int gridLen = 64;
+    for (int i = 0; i < gridLen; ++i) {
+        for (int j = 0; j < gridLen; ++j) {
+            float height = 0.1f + 0.3f * ((i * 7 + j * 13) % 10) / 10.0f;
+            glm::vec3 pos = { (i - gridLen * 0.5f) * 0.3f, -1 + height * 0.5f, 2 + j * 0.3f };
+            glm::mat4 transform = glm::translate(glm::mat4(1), pos);
+            transform = glm::rotate(transform, glm::radians((float)((i * 31 + j * 17) % 90)), {0, 1, 0});
+            transform = glm::scale(transform, {0.15, height, 0.15});
+            world->addInstance((i + j) % 3 == 0 ? sphere : cube, transform, materials[(i * 3 + j * 5) % 4]);
+        }
+    }
+
+    m.albedo = {0, 0, 0};
+    m.roughness = 1.0;
+    m.metallic = 0.0;
+    m.emissionColor = {1, 1, 1};
+    m.emissionStrength = 300;
+    world->add<Sphere>(
+            { 1, {-5, 8, -15}, 1 },
+            m, false
+        );
+}
+
+bool loadMeshFile(World* world, const std::string& path) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point st = Clock::now();
+
+    Mesh mesh;
+    if (!Mesh::LoadOBJ(path, mesh)) {
+        return false;
+    }
+    f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+    printf("%s: %u vertices, %u triangles, loaded in %.2fms\n", path.c_str(),
+            (u32)mesh.positions.size(), mesh.triangleCount(), ms);
+
+    mesh.fit({0, -1, 6}, 2);
+
+    Material m;
+    m.roughness = 0.5;
+    m.albedo = {0.9, 0.9, 0.9};
+    world->add<Mesh>(mesh, m);
+    return true;
+}
+
+const SceneEntry sceneTable[] = {
+    { "scene1", loadScene1 },
+    { "scene2", loadScene2 },
+    { "scene3", loadScene3 },
+    { "roughnessMetallic", RoughnessMetallicTest },
+    { "boxGrid", BoxGridTest },
+    { "meshTest", MeshTest },
+    { "instanceGrid", InstanceGridTest },
+};
+
+const u32 sceneCount = sizeof(sceneTable) / sizeof(SceneEntry);
+
+bool loadScene(World* world, const std::string& name) {
+    for (u32 i = 0; i < sceneCount; ++i) {
+        if (name == sceneTable[i].name) {
+            sceneTable[i].load(world);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Names what a scene cache is built from: the scene and its generator
+// revision, and the mesh file with its size and modification time, so an
+// edited generator or OBJ misses the old cache.
+static std::string sceneCacheKey(const Options& opt) {
+    std::string key = opt.scene + "|" + std::to_string(SCENE_REVISION) + "|" + opt.mesh;
+    struct stat st;
+    if (!opt.mesh.empty() && stat(opt.mesh.c_str(), &st) == 0) {
+        key += "|" + std::to_string((u64)st.st_size) + "|" + std::to_string((i64)st.st_mtime);
+    }
+    return key;
+}
+
+bool loadWorld(World* world, const Options& opt) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point st = Clock::now();
+
+    const std::string key = sceneCacheKey(opt);
+    if (!opt.cache.empty() && loadSceneCache(opt.cache, key, *world)) {
+        f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+        printf("%s: mapped scene cache in %.2fms\n", opt.cache.c_str(), ms);
+        return true;
+    }
+
+    if (!loadScene(world, opt.scene)) {
+        printf("unknown scene '%s'\n", opt.scene.c_str());
+        return false;
+    }
+    if (!opt.mesh.empty() && !loadMeshFile(world, opt.mesh)) {
+        printf("failed to load mesh '%s'\n", opt.mesh.c_str());
+        return false;
+    }
+
+    if (!opt.cache.empty()) {
+        if (writeSceneCache(opt.cache, key, *world)) {
+            printf("%s: wrote scene cache\n", opt.cache.c_str());
+        }
+        else {
+            printf("failed to write scene cache '%s'\n", opt.cache.c_str());
+        }
+    }
+    f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+    printf("scene loaded in %.2fms\n", ms);
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <string>
+#include "World.h"
+#include "Options.h"
+
+void loadCornellBox(World* world, const glm::vec3& pos, float boxLen = 3, float lightLen = 0.7);
+void loadBox(World* world, glm::vec2 len, glm::vec3 pos, float degree);
+
+void loadScene1(World* world);
+void loadScene2(World* world);
+void loadScene3(World* world);
+void RoughnessMetallicTest(World* world);
+void BoxGridTest(World* world);
+void MeshTest(World* world);
+void InstanceGridTest(World* world);
+
+struct SceneEntry {
+    const char* name;
+    void (*load)(World* world);
+};
+
+// Built-in scenes addressable by name from the command line.
+extern const SceneEntry sceneTable[];
+// Part of the scene cache key; bump it whenever a scene generator changes
+// what it builds.
+static const u32 SCENE_REVISION = 1;
+extern const u32 sceneCount;
+
+bool loadScene(World* world, const std::string& name);
+
+// Loads an OBJ file and scales it into the middle of the Cornell box used
+// by scene3 and MeshTest.
+bool loadMeshFile(World* world, const std::string& path);
+
+// Fills the world from opt.cache when it was written for the same scene
+// and mesh; otherwise loads both and writes the cache for the next run.
+// Prints what went wrong and returns false on failure.
+bool loadWorld(World* world, const Options& opt);
+
+#endif
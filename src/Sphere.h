@@ -20,4 +20,19 @@ struct Sphere {
     int aabbIndex;
 };
 
+// Sphere as raytrace.comp reads it with PACKED_PRIMITIVES: a single
+// 16-byte load, instead of Sphere's 48 std430 bytes; the material index
+// lives in World's primitive material list.
+struct PackedSphere {
+    PackedSphere() = default;
+    explicit PackedSphere(const Sphere& sphere)
+        : centerRadius(sphere.center, sphere.radius)
+    {}
+
+    glm::vec4 centerRadius;
+};
+
+static_assert(sizeof(Sphere) == 48, "Sphere must match the std430 layout in raytrace.comp");
+static_assert(sizeof(PackedSphere) == 16, "PackedSphere must match the packed layout in raytrace.comp");
+
 #endif
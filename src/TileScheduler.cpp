@@ -0,0 +1,79 @@
+#include "TileScheduler.h"
+#include <algorithm>
+
+TileScheduler::TileScheduler()
+    : m_resolution(0), m_tileSize(0), m_cursor(0), m_msPerTile(0)
+{
+    std::fill(m_issued, m_issued + HISTORY, 0u);
+}
+
+void TileScheduler::resize(const glm::ivec2& resolution, i32 tileSize) {
+    m_resolution = resolution;
+    m_tileSize = tileSize;
+    m_tiles.clear();
+    for (i32 y = 0; y < resolution.y; y += tileSize) {
+        for (i32 x = 0; x < resolution.x; x += tileSize) {
+            Tile tile;
+            tile.origin = glm::ivec2(x, y);
+            tile.size = glm::ivec2(std::min(tileSize, resolution.x - x), std::min(tileSize, resolution.y - y));
+            tile.sampleCount = 0;
+            m_tiles.push_back(tile);
+        }
+    }
+    m_cursor = 0;
+    m_msPerTile = 0;
+}
+
+void TileScheduler::reset() {
+    for (Tile& tile : m_tiles) {
+        tile.sampleCount = 0;
+    }
+    m_cursor = 0;
+}
+
+const std::vector<u32>& TileScheduler::schedule(u32 frame, f64 budgetMs) {
+    const u32 count = (u32)m_tiles.size();
+    u32 n = count;
+    if (budgetMs > 0) {
+        // One tile until the first timing arrives, the cost of a full
+        // frame is unknown.
+        n = m_msPerTile > 0 ? (u32)std::max(1.0, std::min((f64)count, budgetMs / m_msPerTile)) : std::min(1u, count);
+    }
+
+    // Round robin from where the last frame stopped keeps the sample
+    // counts of all tiles within one of each other.
+    m_scheduled.clear();
+    for (u32 i = 0; i < n; ++i) {
+        m_scheduled.push_back((m_cursor + i) % count);
+    }
+    m_cursor = count ? (m_cursor + n) % count : 0;
+    m_issued[frame % HISTORY] = n;
+    return m_scheduled;
+}
+
+void TileScheduler::measured(u32 frame, f64 ms) {
+    const u32 issued = m_issued[frame % HISTORY];
+    if (issued == 0 || ms <= 0) {
+        return;
+    }
+    const f64 perTile = ms / issued;
+    // Reacts within a few frames when bounces or spp change, without
+    // jittering on every frame's noise.
+    m_msPerTile = m_msPerTile == 0 ? perTile : m_msPerTile * 0.7 + perTile * 0.3;
+}
+
+u32 TileScheduler::minSamples() const {
+    u32 samples = m_tiles.empty() ? 0 : m_tiles[0].sampleCount;
+    for (const Tile& tile : m_tiles) {
+        samples = std::min(samples, tile.sampleCount);
+    }
+    return samples;
+}
+
+u32 TileScheduler::maxSamples() const {
+    u32 samples = 0;
+    for (const Tile& tile : m_tiles) {
+        samples = std::max(samples, tile.sampleCount);
+    }
+    return samples;
+}
@@ -0,0 +1,60 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "util.h"
+
+// Splits the image into square tiles that are traced by separate
+// dispatches, each with its own sample count. Tiles are handed out round
+// robin, as many per frame as the GPU time budget allows, so a frame never
+// takes much longer than the budget however expensive a sample is.
+class TileScheduler {
+public:
+    struct Tile {
+        glm::ivec2 origin, size;
+        // Samples accumulated so far; the next dispatch traces sample
+        // sampleCount + 1 (the kernel's frameIndex).
+        u32 sampleCount;
+    };
+
+private:
+    glm::ivec2 m_resolution;
+    i32 m_tileSize;
+    std::vector<Tile> m_tiles;
+    std::vector<u32> m_scheduled;
+    u32 m_cursor;
+
+    // GPU milliseconds per tile, learnt from the profiler.
+    f64 m_msPerTile;
+    // Tiles issued by the last few frames, so late timings can be matched
+    // to the frame they measured.
+    static const u32 HISTORY = 4;
+    u32 m_issued[HISTORY];
+
+public:
+    TileScheduler();
+
+    // Re-tiles the image and clears every tile.
+    void resize(const glm::ivec2& resolution, i32 tileSize);
+    // Restarts accumulation, e.g. after the camera moved.
+    void reset();
+
+    // Tiles to trace in frame `frame`. A budget <= 0 schedules all of them.
+    const std::vector<u32>& schedule(u32 frame, f64 budgetMs);
+    // Called after dispatching a tile.
+    inline void traced(u32 tile) { ++m_tiles[tile].sampleCount; }
+    // Feeds back the GPU time the tiles of `frame` took.
+    void measured(u32 frame, f64 ms);
+
+    inline const Tile& tile(u32 index) const { return m_tiles[index]; }
+    inline u32 tileCount() const { return (u32)m_tiles.size(); }
+    // Tiles handed out by the last schedule() call.
+    inline u32 scheduledCount() const { return (u32)m_scheduled.size(); }
+    inline const glm::ivec2& resolution() const { return m_resolution; }
+    inline f64 msPerTile() const { return m_msPerTile; }
+    u32 minSamples() const;
+    u32 maxSamples() const;
+};
+
+#endif
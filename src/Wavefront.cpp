@@ -0,0 +1,149 @@
+#include "Wavefront.h"
+#include <algorithm>
+#include <cstddef>
+#include "glad/glad.h"
+#include "OpenGL/Renderer.h"
+
+#define PATHS_BINDING 19
+#define HITS_BINDING 20
+#define SHADOW_RAYS_BINDING 21
+#define QUEUES_BINDING 22
+#define STAGE_GROUP_SIZE 64
+
+Wavefront::Wavefront()
+    : m_capacity(0)
+{}
+
+const char* Wavefront::stageName(u32 stage) {
+    switch (stage) {
+    case Generate: return "generate";
+    case Queue: return "queue";
+    case Extend: return "extend";
+    case Shade: return "shade";
+    case Connect: return "connect";
+    case Resolve: return "resolve";
+    case Bin: return "bin";
+    case Sort: return "sort";
+    default: return "megakernel";
+    }
+}
+
+void Wavefront::reserve(u32 paths) {
+    if (paths <= m_capacity) {
+        return;
+    }
+    m_capacity = paths;
+    m_paths.setBuffer(nullptr, paths * sizeof(WavefrontPath));
+    m_hits.setBuffer(nullptr, paths * sizeof(WavefrontHit));
+    m_shadowRays.setBuffer(nullptr, paths * sizeof(WavefrontShadowRay));
+    // The three ray queues follow the counters.
+    m_queues.setBuffer(nullptr, sizeof(WavefrontQueues) + 3 * paths * sizeof(u32));
+}
+
+void Wavefront::release() {
+    m_paths.release();
+    m_hits.release();
+    m_shadowRays.release();
+    m_queues.release();
+    m_capacity = 0;
+}
+
+void Wavefront::trace(gl::ComputeShader* const stages[STAGE_END], u32 pixels, u32 samplesPerPixel, u32 bounces,
+        bool sortByMaterial, gl::GpuProfiler& profiler) {
+    const u64 total = (u64)pixels * samplesPerPixel;
+    if (total == 0) {
+        return;
+    }
+    // A wave holds whole pixels so resolve sees all of a pixel's samples.
+    reserve((u32)std::min<u64>(total, MAX_PATHS / samplesPerPixel * samplesPerPixel));
+    const u32 wavePaths = m_capacity / samplesPerPixel * samplesPerPixel;
+
+    m_paths.binding(PATHS_BINDING);
+    m_hits.binding(HITS_BINDING);
+    m_shadowRays.binding(SHADOW_RAYS_BINDING);
+    m_queues.binding(QUEUES_BINDING);
+    m_queues.bindIndirect();
+
+    // Every stage reads what the one before wrote, and the queue stage
+    // writes the indirect arguments.
+    for (u32 stage = Generate; stage < STAGE_END; ++stage) {
+        stages[stage]->setBarriers(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT |
+                GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    for (u64 offset = 0; offset < total; offset += wavePaths) {
+        const u32 count = (u32)std::min<u64>(total - offset, wavePaths);
+        WavefrontQueues queues = {};
+        queues.pathOffset = (u32)offset;
+        queues.pathCount = count;
+        // The queue stage starts every bounce by advancing it.
+        queues.bounce = -1;
+        queues.sortByMaterial = sortByMaterial;
+        m_queues.updateBuffer(&queues, sizeof(queues));
+
+        gl::ComputeShader& generate = *stages[Generate];
+        generate.bind();
+        generate.updateGroups({ (count + STAGE_GROUP_SIZE - 1) / STAGE_GROUP_SIZE, 1, 1 });
+        profiler.begin(stageName(Generate));
+        generate.use();
+        profiler.end();
+
+        for (u32 bounce = 0; bounce < bounces; ++bounce) {
+            gl::ComputeShader& queue = *stages[Queue];
+            queue.bind();
+            queue.updateGroups({ 1, 1, 1 });
+            queue.use();
+
+            // The last bounce does no light sampling, so its shadow rays
+            // never need a pass after the loop.
+            if (bounce > 0) {
+                stages[Connect]->bind();
+                profiler.begin(stageName(Connect));
+                stages[Connect]->useIndirect(offsetof(WavefrontQueues, connectGroups));
+                profiler.end();
+            }
+
+            stages[Extend]->bind();
+            profiler.begin(stageName(Extend));
+            stages[Extend]->useIndirect(offsetof(WavefrontQueues, extendGroups));
+            profiler.end();
+
+            // A counting sort: extend counted the hits per material, bin
+            // turns the counts into offsets and sort places every path.
+            if (sortByMaterial) {
+                gl::ComputeShader& bin = *stages[Bin];
+                bin.bind();
+                bin.updateGroups({ 1, 1, 1 });
+                bin.use();
+
+                stages[Sort]->bind();
+                profiler.begin(stageName(Sort));
+                stages[Sort]->useIndirect(offsetof(WavefrontQueues, extendGroups));
+                profiler.end();
+            }
+
+            stages[Shade]->bind();
+            profiler.begin(stageName(Shade));
+            stages[Shade]->useIndirect(offsetof(WavefrontQueues, extendGroups));
+            profiler.end();
+        }
+
+        gl::ComputeShader& resolve = *stages[Resolve];
+        resolve.bind();
+        resolve.updateGroups({ (count / samplesPerPixel + STAGE_GROUP_SIZE - 1) / STAGE_GROUP_SIZE, 1, 1 });
+        profiler.begin(stageName(Resolve));
+        resolve.use();
+        profiler.end();
+    }
+}
+
+f64 Wavefront::lastMs(const gl::GpuProfiler& profiler) const {
+    f64 ms = 0;
+    for (u32 stage = Generate; stage < STAGE_END; ++stage) {
+        const i32 pass = profiler.findPass(stageName(stage));
+        if (pass >= 0) {
+            ms += profiler.lastMs((u32)pass);
+        }
+    }
+    return ms;
+}
@@ -0,0 +1,118 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "OpenGL/ShaderStorageBuffer.h"
+#include "OpenGL/ComputeShader.h"
+#include "OpenGL/GpuProfiler.h"
+#include "util.h"
+
+// Wavefront path tracing: instead of one thread following a path through
+// every bounce, the paths of a batch of tiles advance one bounce at a time
+// through separate passes, each a raytrace.comp variant built with
+// WAVEFRONT_STAGE:
+//
+//     generate                 camera rays for every sample of the wave
+//     per bounce:
+//       queue                  group counts for the passes below
+//       connect                shadow rays of the previous bounce
+//       extend                 closest hits of the live paths
+//       bin, sort              optionally, groups the hits by material
+//       shade                  emission, light sampling, next direction
+//     resolve                  averages the samples into the image
+//
+// Shading appends the paths that go on and the shadow rays it wants traced
+// to queues with atomic counters, so finished paths drop out and every
+// pass runs full work groups of live paths only. Sorting by material
+// additionally has neighbouring shade threads run the same material.
+class Wavefront {
+public:
+    // WAVEFRONT_STAGE values; 0 is the megakernel.
+    enum Stage { Generate = 1, Queue, Extend, Shade, Connect, Resolve, Bin, Sort, STAGE_END };
+
+    // Material bins of the sort, see materialBin() in raytrace.comp.
+    static const u32 SORT_BINS = 256;
+
+    // Paths in flight at once. Larger batches run in several waves.
+    static const u32 MAX_PATHS = 1 << 19;
+
+    // Name of the stage's profiler pass; the queue stage is not timed.
+    static const char* stageName(u32 stage);
+
+private:
+    gl::ShaderStorageBuffer m_paths;
+    gl::ShaderStorageBuffer m_hits;
+    gl::ShaderStorageBuffer m_shadowRays;
+    gl::ShaderStorageBuffer m_queues;
+    u32 m_capacity;
+
+    void reserve(u32 paths);
+
+public:
+    Wavefront();
+
+    // Traces `samplesPerPixel` paths for each of the `pixels` pixels of the
+    // tiles in the bound FrameUniforms, `stages[s]` being the program for
+    // stage s. Stage times go to `profiler` under stageName().
+    void trace(gl::ComputeShader* const stages[STAGE_END], u32 pixels, u32 samplesPerPixel, u32 bounces,
+            bool sortByMaterial, gl::GpuProfiler& profiler);
+    // Deletes the buffers; call while the context is current.
+    void release();
+
+    // Sum of the stage times of the last profiled frame.
+    f64 lastMs(const gl::GpuProfiler& profiler) const;
+    inline u32 capacity() const { return m_capacity; }
+
+};
+
+// Per-path records of the wavefront stages, laid out like the std430
+// structs of the same names in raytrace.comp.
+struct WavefrontPath {
+    f32 origin[3];
+    u32 seed;
+    f32 direction[3];
+    f32 prevPdf;
+    f32 throughput[3];
+    i32 prevDelta;
+    f32 radiance[3];
+    i32 pad;
+};
+
+struct WavefrontHit {
+    f32 normal[3];
+    f32 t;
+    i32 matId;
+    i32 primRef;
+    i32 pad[2];
+};
+
+struct WavefrontShadowRay {
+    f32 origin[3];
+    f32 maxT;
+    f32 direction[3];
+    u32 path;
+    f32 contribution[3];
+    i32 pad;
+};
+
+// Queue counters and indirect dispatch arguments, written before every
+// wave; the ray queues follow in the same buffer.
+struct WavefrontQueues {
+    u32 extendGroups[4];
+    u32 connectGroups[4];
+    u32 pathOffset;
+    u32 pathCount;
+    i32 bounce;
+    u32 shadowActive;
+    u32 rayCount[2];
+    u32 shadowCount;
+    u32 sortByMaterial;
+    u32 binCount[Wavefront::SORT_BINS];
+    u32 binOffset[Wavefront::SORT_BINS];
+};
+
+static_assert(sizeof(WavefrontPath) == 64, "WavefrontPath must match PathState in raytrace.comp");
+static_assert(sizeof(WavefrontHit) == 32, "WavefrontHit must match HitRecord in raytrace.comp");
+static_assert(sizeof(WavefrontShadowRay) == 48, "WavefrontShadowRay must match ShadowRay in raytrace.comp");
+static_assert(sizeof(WavefrontQueues) == 64 + 2 * 4 * Wavefront::SORT_BINS, "WavefrontQueues must match the WavefrontQueues block in raytrace.comp");
+
+#endif
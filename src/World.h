@@ -2,12 +2,19 @@
 #define WORLD_H
 
 #include <vector>
+#include <cstdio>
+#include <cstring>
 #include "util.h"
 #include "AABB.h"
 #include "Material.h"
 #include "Sphere.h"
 #include "OpenGL/ShaderStorageBuffer.h"
 #include "Quad.h"
+#include "BVH.h"
+#include "Mesh.h"
+#include "ArrayView.h"
+#include "MappedFile.h"
+#include "DirtyRange.h"
 
 class World {
 private:
@@ -19,18 +26,325 @@ private:
     u32 aabbBindingIndex = 10;
 
     std::vector<Material> materials;
+    DirtyRange materialsDirty;
+    // Whether each material emitted when the light list was last built.
+    std::vector<bool> materialEmissive;
+    // KERNEL_EMISSIVE and KERNEL_SUBSURFACE if any material needs them, so
+    // kernelFeatures() does not scan the materials every frame. Edits can
+    // only add bits right away; updateBuffer() drops the stale ones.
+    u32 materialFeatures = 0;
     gl::ShaderStorageBuffer materialBuffer;
     u32 materialBindingIndex = 1;
 
     std::vector<Sphere> spheres;
+    DirtyRange spheresDirty;
     gl::ShaderStorageBuffer sphereBuffer;
     u32 sphereBindingIndex = 2;
 
     std::vector<Quad> quads;
+    DirtyRange quadsDirty;
     gl::ShaderStorageBuffer quadBuffer;
     u32 quadBindingIndex = 3;
 
+    // The GPU layout of spheres and quads, see setPackedPrimitives(). Packed,
+    // the sphere and quad buffers hold PackedSphere and PackedQuad, and the
+    // material index of every sphere, then every quad, takes the binding of
+    // the AABBs, which the kernel never reads.
+    bool packedPrimitives = false;
+    std::vector<PackedSphere> packedSpheres;
+    std::vector<PackedQuad> packedQuads;
+    std::vector<i32> primitiveMaterials;
+    gl::ShaderStorageBuffer primitiveMaterialBuffer;
+
+    BVH bvh;
+    bool bvhDirty = true;
+    // Bumped whenever a sphere or quad is added or edited, see
+    // getGeometryRevision().
+    u32 geometryRevision = 0;
+    gl::ShaderStorageBuffer bvhNodeBuffer;
+    u32 bvhNodeBindingIndex = 11;
+
+    // Leaf-ordered primitive references, (index << 1) | PrimitiveType.
+    std::vector<i32> primitiveRefs;
+    gl::ShaderStorageBuffer bvhPrimBuffer;
+    u32 bvhPrimBindingIndex = 12;
+
+    // Primitive references of every emissive sphere and quad, sampled by
+    // next event estimation.
+    std::vector<i32> lights;
+    gl::ShaderStorageBuffer lightBuffer;
+    u32 lightBindingIndex = 13;
+
+    // Every added mesh, merged. Positions are tightly packed xyz floats,
+    // normals octahedral snorm16x2 and triangles (i0, i1, i2, material),
+    // stored in the leaf order of meshBVH.
+    std::vector<f32> meshPositions;
+    gl::ShaderStorageBuffer meshPositionBuffer;
+    u32 meshPositionBindingIndex = 14;
+
+    std::vector<u32> meshNormals;
+    gl::ShaderStorageBuffer meshNormalBuffer;
+    u32 meshNormalBindingIndex = 15;
+
+    std::vector<glm::uvec4> meshTriangles;
+    gl::ShaderStorageBuffer meshTriangleBuffer;
+    u32 meshTriangleBindingIndex = 16;
+
+    BVH meshBVH;
+    bool meshBVHDirty = false;
+    gl::ShaderStorageBuffer meshNodeBuffer;
+    u32 meshNodeBindingIndex = 17;
+
+    // Shapes for instancing (addShape()): their vertices are appended to
+    // meshPositions and meshNormals, their triangles kept apart until
+    // buildInstances() gives each shape its own hierarchy.
+    struct Shape {
+        u32 firstTriangle;
+        u32 triangleCount;
+    };
+    std::vector<Shape> shapes;
+    std::vector<glm::uvec4> shapeTriangles;
+    std::vector<Instance> instances;
+
+    // The two-level hierarchy, built when there are instances; the mesh
+    // buffers then hold these instead of meshTriangles and meshBVH.nodes.
+    // levelTriangles: the merged meshes' triangles, every shape's, then
+    // one InstanceRecord per instance in the leaf order of instanceBVH.
+    // levelNodes: the root over the merged meshes' root and the top
+    // level's, then their nodes and every shape's bottom level. Top-level
+    // leaves have a negative count, the number of instances.
+    std::vector<glm::uvec4> levelTriangles;
+    std::vector<BVHNode> levelNodes;
+    BVH instanceBVH;
+    u32 instanceCount = 0;
+
+    // What the tracers and uploads read for meshes: the vectors above, or
+    // the sections of a mapped scene cache (see SceneCache.h).
+    MappedFile cacheFile;
+    ArrayView<f32> meshPositionView;
+    ArrayView<u32> meshNormalView;
+    ArrayView<glm::uvec4> meshTriangleView;
+    ArrayView<BVHNode> meshNodeView;
+
+    template <typename T>
+    static void uploadRange(gl::ShaderStorageBuffer& buffer, const std::vector<T>& data, DirtyRange& range) {
+        if (range.empty()) {
+            return;
+        }
+        buffer.updateBuffer(&data[range.begin], (range.end - range.begin) * sizeof(T), range.begin * sizeof(T));
+        range.clear();
+    }
+
+    // Repacks spheres and quads [begin, end) for the packed layout.
+    void packSpheres(u32 begin, u32 end) {
+        packedSpheres.resize(spheres.size());
+        primitiveMaterials.resize(spheres.size() + quads.size());
+        for (u32 i = begin; i < end; ++i) {
+            packedSpheres[i] = PackedSphere(spheres[i]);
+            primitiveMaterials[i] = spheres[i].materialIndex;
+        }
+    }
+
+    void packQuads(u32 begin, u32 end) {
+        packedQuads.resize(quads.size());
+        primitiveMaterials.resize(spheres.size() + quads.size());
+        for (u32 i = begin; i < end; ++i) {
+            packedQuads[i] = PackedQuad(quads[i]);
+            primitiveMaterials[spheres.size() + i] = quads[i].materialIndex;
+        }
+    }
+
+    // uploadRange() for the packed layout: repacks the range and uploads it
+    // with its material indices.
+    void uploadPackedSpheres() {
+        if (spheresDirty.empty()) {
+            return;
+        }
+        const u32 begin = spheresDirty.begin, end = spheresDirty.end;
+        packSpheres(begin, end);
+        sphereBuffer.updateBuffer(&packedSpheres[begin], (end - begin) * sizeof(PackedSphere), begin * sizeof(PackedSphere));
+        primitiveMaterialBuffer.updateBuffer(&primitiveMaterials[begin], (end - begin) * sizeof(i32), begin * sizeof(i32));
+        spheresDirty.clear();
+    }
+
+    void uploadPackedQuads() {
+        if (quadsDirty.empty()) {
+            return;
+        }
+        const u32 begin = quadsDirty.begin, end = quadsDirty.end;
+        const u32 materialBegin = (u32)spheres.size() + begin;
+        packQuads(begin, end);
+        quadBuffer.updateBuffer(&packedQuads[begin], (end - begin) * sizeof(PackedQuad), begin * sizeof(PackedQuad));
+        primitiveMaterialBuffer.updateBuffer(&primitiveMaterials[materialBegin], (end - begin) * sizeof(i32), materialBegin * sizeof(i32));
+        quadsDirty.clear();
+    }
+
+    void refreshMeshViews() {
+        meshPositionView = meshPositions;
+        meshNormalView = meshNormals;
+        meshTriangleView = levelNodes.empty() ? meshTriangles : levelTriangles;
+        meshNodeView = levelNodes.empty() ? meshBVH.nodes : levelNodes;
+    }
+
+    // Appends the mesh's vertices; returns the index of the first.
+    u32 appendMeshVertices(const Mesh& mesh) {
+        const u32 base = (u32)(meshPositions.size() / 3);
+        meshPositions.reserve(meshPositions.size() + mesh.positions.size() * 3);
+        meshNormals.reserve(meshNormals.size() + mesh.positions.size());
+        for (u32 i = 0; i < mesh.positions.size(); ++i) {
+            meshPositions.push_back(mesh.positions[i].x);
+            meshPositions.push_back(mesh.positions[i].y);
+            meshPositions.push_back(mesh.positions[i].z);
+            meshNormals.push_back(Mesh::PackNormal(i < mesh.normals.size() ? mesh.normals[i] : glm::vec3(0, 1, 0)));
+        }
+        return base;
+    }
+
+    Bounds triangleBounds(const glm::uvec4& tri) const {
+        Bounds b;
+        for (u32 k = 0; k < 3; ++k) {
+            const f32* p = &meshPositions[tri[k] * 3];
+            b.grow(glm::vec3(p[0], p[1], p[2]));
+        }
+        return b;
+    }
+
+    // Copies `tree` into levelNodes: its root into the reserved node
+    // `root`, the others appended, with child links moved along. Leaf
+    // ranges are rebased to `first` with `stride` triangle entries per
+    // primitive; instance leaves get their count negated.
+    void appendTree(const std::vector<BVHNode>& tree, u32 root, u32 first, u32 stride, bool instanceLeaves) {
+        const u32 base = (u32)levelNodes.size() - 1;
+        for (u32 i = 0; i < tree.size(); ++i) {
+            BVHNode node = tree[i];
+            if (node.count > 0) {
+                node.leftFirst = (i32)(first + node.leftFirst * stride);
+                node.count = instanceLeaves ? -node.count : node.count;
+            }
+            else {
+                node.leftFirst += base;
+            }
+            if (i == 0) {
+                levelNodes[root] = node;
+            }
+            else {
+                levelNodes.push_back(node);
+            }
+        }
+    }
+
+    // Builds a bottom-level hierarchy per shape and the top level over the
+    // instances into levelTriangles and levelNodes. Runs after the merged
+    // meshes' hierarchy, whose triangles and nodes it copies.
+    void buildInstances() {
+        levelTriangles.clear();
+        levelNodes.clear();
+        instanceBVH.clear();
+
+        // Instances of shapes without triangles have nothing to hit.
+        std::vector<u32> placed;
+        for (u32 i = 0; i < instances.size(); ++i) {
+            if (shapes[instances[i].shape].triangleCount > 0) {
+                placed.push_back(i);
+            }
+        }
+        instanceCount = (u32)placed.size();
+        if (placed.empty()) {
+            return;
+        }
+
+        // With merged meshes as well, node 0 is an interior node whose
+        // children are their root and the top level's, one level more than
+        // the builder allows.
+        static_assert(BVH::STACK_SIZE >= BVH::MAX_DEPTH + 1, "traversal stacks must hold the joined level");
+        const bool merged = !meshBVH.nodes.empty();
+        const u32 topRoot = merged ? 2 : 0;
+        levelTriangles = meshTriangles;
+        levelNodes.resize(merged ? 3 : 1);
+        if (merged) {
+            appendTree(meshBVH.nodes, 1, 0, 1, false);
+        }
+
+        std::vector<u32> roots(shapes.size());
+        std::vector<Bounds> shapeBounds(shapes.size());
+        for (u32 s = 0; s < shapes.size(); ++s) {
+            const Shape& shape = shapes[s];
+            if (shape.triangleCount == 0) {
+                continue;
+            }
+            std::vector<Bounds> triBounds(shape.triangleCount);
+            for (u32 i = 0; i < shape.triangleCount; ++i) {
+                triBounds[i] = triangleBounds(shapeTriangles[shape.firstTriangle + i]);
+            }
+            BVH blas;
+            blas.build(triBounds);
+
+            const u32 first = (u32)levelTriangles.size();
+            for (u32 i = 0; i < blas.indices.size(); ++i) {
+                levelTriangles.push_back(shapeTriangles[shape.firstTriangle + blas.indices[i]]);
+            }
+            roots[s] = (u32)levelNodes.size();
+            levelNodes.push_back(BVHNode());
+            appendTree(blas.nodes, roots[s], first, 1, false);
+            shapeBounds[s] = Bounds(blas.nodes[0].min, blas.nodes[0].max);
+        }
+
+        std::vector<Bounds> instBounds(placed.size());
+        for (u32 i = 0; i < placed.size(); ++i) {
+            const Instance& inst = instances[placed[i]];
+            const Bounds& b = shapeBounds[inst.shape];
+            for (u32 corner = 0; corner < 8; ++corner) {
+                const glm::vec3 p((corner & 1) ? b.max.x : b.min.x, (corner & 2) ? b.max.y : b.min.y,
+                                  (corner & 4) ? b.max.z : b.min.z);
+                instBounds[i].grow(glm::vec3(inst.transform * glm::vec4(p, 1.0f)));
+            }
+        }
+        // An instance test walks a whole bottom level, so leaves hold one
+        // instance wherever the centroids can be told apart.
+        instanceBVH.build(instBounds, 1);
+
+        const u32 first = (u32)levelTriangles.size();
+        const u32 stride = sizeof(InstanceRecord) / sizeof(glm::uvec4);
+        levelTriangles.resize(first + placed.size() * stride);
+        for (u32 i = 0; i < instanceBVH.indices.size(); ++i) {
+            const Instance& inst = instances[placed[instanceBVH.indices[i]]];
+            const glm::mat4 worldToObject = glm::inverse(inst.transform);
+            InstanceRecord record = InstanceRecord();
+            for (u32 row = 0; row < 3; ++row) {
+                record.worldToObject[row] = glm::vec4(worldToObject[0][row], worldToObject[1][row],
+                                                      worldToObject[2][row], worldToObject[3][row]);
+            }
+            record.root = roots[inst.shape];
+            record.material = inst.material;
+            memcpy((void*)&levelTriangles[first + i * stride], &record, sizeof(record));
+        }
+        appendTree(instanceBVH.nodes, topRoot, first, stride, true);
+        std::vector<u32>().swap(instanceBVH.indices);
+
+        if (merged) {
+            BVHNode& node = levelNodes[0];
+            node.min = glm::min(levelNodes[1].min, levelNodes[2].min);
+            node.max = glm::max(levelNodes[1].max, levelNodes[2].max);
+            node.leftFirst = 1;
+            node.count = 0;
+        }
+    }
+
+    friend bool writeSceneCache(const std::string& path, const std::string& key, World& world);
+    friend bool loadSceneCache(const std::string& path, const std::string& key, World& world);
+
 public:
+    enum PrimitiveType {
+        PRIMITIVE_SPHERE = 0,
+        PRIMITIVE_QUAD = 1,
+    };
+
+    // SAMPLER_* in raytrace.comp.
+    enum Sampler {
+        SAMPLER_PCG = 0,
+        SAMPLER_SOBOL = 1,
+    };
+
     glm::vec3 skyColor = {0.5, 0.7, 1};
     float exposure = 1.0, gamma = 2.2;
 
@@ -42,49 +356,371 @@ public:
             right = glm::vec3(1, 0, 0),
             forward = glm::vec3(0, 0, 1);
         int bounces = 5, rayPerPixel = 2;
+        bool lightSampling = true;
+        // Russian roulette, see raytrace.comp.
+        bool roulette = true;
+        int rouletteDepth = 3;
+        float rouletteMinSurvival = 0.05f;
+        // Random numbers of the GPU kernel, see randFloat() in raytrace.comp.
+        int sampler = SAMPLER_PCG;
     } cam;
 
+    static bool isEmissive(const Material& mat) {
+        return mat.emissionStrength > 0.0f && mat.emissionColor != glm::vec3(0.0f);
+    }
+
+    static u32 materialFeatureBits(const Material& mat) {
+        u32 bits = 0;
+        if (isEmissive(mat)) bits |= KERNEL_EMISSIVE;
+        if (mat.subsurface > 0.0f) bits |= KERNEL_SUBSURFACE;
+        return bits;
+    }
+
+    void refreshMaterialFeatures() {
+        materialFeatures = 0;
+        for (const Material& mat : materials) {
+            materialFeatures |= materialFeatureBits(mat);
+        }
+    }
+
 public:
-    World()
-        : aabbBuffer(nullptr, 0)
-        , materialBuffer(nullptr, 0)
-        , sphereBuffer(nullptr, 0)
-        , quadBuffer(nullptr, 0)
-    {}
+    World() = default;
 
+    // Edits through the non-const getter must be reported with
+    // markMaterialDirty() to reach the GPU.
     std::vector<Material>& getMaterials() { return materials; }
+    void markMaterialDirty(u32 index) {
+        materialsDirty.add(index);
+        materialFeatures |= materialFeatureBits(materials[index]);
+    }
+
+    void setSphere(u32 index, const Sphere& sphere) {
+        spheres[index] = sphere;
+        spheresDirty.add(index);
+        bvhDirty = true;
+        ++geometryRevision;
+    }
+
+    void setQuad(u32 index, const Quad& quad) {
+        quads[index] = quad;
+        quadsDirty.add(index);
+        bvhDirty = true;
+        ++geometryRevision;
+    }
+
+    // Parts of raytrace.comp a scene needs; a kernel variant is compiled
+    // without the others (see Application::kernel()).
+    enum KernelFeature {
+        KERNEL_SPHERES = 1 << 0,
+        KERNEL_QUADS = 1 << 1,
+        KERNEL_MESHES = 1 << 2,
+        KERNEL_EMISSIVE = 1 << 3,
+        KERNEL_SUBSURFACE = 1 << 4,
+        KERNEL_INSTANCES = 1 << 5,
+        KERNEL_ALL = (1 << 6) - 1,
+        // Not a scene feature but the buffer layout, which every variant,
+        // the one for all features too, must match.
+        KERNEL_PACKED = 1 << 6,
+    };
+
+    // Checked every frame, since material edits can change the answer.
+    u32 kernelFeatures() const {
+        u32 features = materialFeatures;
+        if (!spheres.empty()) features |= KERNEL_SPHERES;
+        if (!quads.empty()) features |= KERNEL_QUADS;
+        if (!meshTriangleView.empty()) features |= KERNEL_MESHES;
+        if (instanceCount > 0) features |= KERNEL_INSTANCES;
+        if (packedPrimitives) features |= KERNEL_PACKED;
+        return features;
+    }
+
+    // Uploads spheres and quads in the packed layout (PackedSphere,
+    // PackedQuad) instead of their std430 structs; takes effect with the
+    // next fetchBuffer().
+    void setPackedPrimitives(bool packed) { packedPrimitives = packed; }
+    bool isPackedPrimitives() const { return packedPrimitives; }
+
+    // GPU bytes per sphere and per quad in the current layout.
+    size_t getSphereBytes() const { return packedPrimitives ? sizeof(PackedSphere) + sizeof(i32) : sizeof(Sphere); }
+    size_t getQuadBytes() const { return packedPrimitives ? sizeof(PackedQuad) + sizeof(i32) : sizeof(Quad); }
+
+    const std::vector<Material>& getMaterials() const { return materials; }
+    const std::vector<Sphere>& getSpheres() const { return spheres; }
+    const std::vector<Quad>& getQuads() const { return quads; }
+    const BVH& getBVH() const { return bvh; }
+    // Changes whenever the spheres or quads do; users that keep their own
+    // copy of them compare it to know when to rebuild.
+    u32 getGeometryRevision() const { return geometryRevision; }
+    const std::vector<i32>& getPrimitiveRefs() const { return primitiveRefs; }
+    const std::vector<i32>& getLights() const { return lights; }
+    ArrayView<f32> getMeshPositions() const { return meshPositionView; }
+    ArrayView<u32> getMeshNormals() const { return meshNormalView; }
+    ArrayView<glm::uvec4> getMeshTriangles() const { return meshTriangleView; }
+    ArrayView<BVHNode> getMeshNodes() const { return meshNodeView; }
+    const BVH& getMeshBVH() const { return meshBVH; }
+
+    // Triangles every instance brings, counting shared ones once per copy;
+    // 0 for a world loaded from a scene cache, which keeps no shapes.
+    u32 getPlacedTriangleCount() const {
+        u32 triangles = 0;
+        for (const Instance& inst : instances) {
+            triangles += shapes[inst.shape].triangleCount;
+        }
+        return triangles;
+    }
+
+    // Mesh triangles, leaving out the instance records stored with them.
+    u32 getMeshTriangleCount() const {
+        return (u32)(meshTriangleView.size() - instanceCount * sizeof(InstanceRecord) / sizeof(glm::uvec4));
+    }
+
+    // GPU memory held by mesh geometry and its hierarchy.
+    size_t getMeshBytes() const {
+        return meshPositionView.size() * sizeof(f32) + meshNormalView.size() * sizeof(u32)
+            + meshTriangleView.size() * sizeof(glm::uvec4) + meshNodeView.size() * sizeof(BVHNode);
+    }
+
+    // Adds a material without an object, for instances to share; returns
+    // its index.
+    u32 addMaterial(const Material& mat) {
+        materials.push_back(mat);
+        materialFeatures |= materialFeatureBits(mat);
+        return objectCount++;
+    }
+
+    // Stores a mesh, in its own object space, once for any number of
+    // addInstance() copies; returns the shape's index.
+    u32 addShape(const Mesh& mesh) {
+        Shape shape;
+        shape.firstTriangle = (u32)shapeTriangles.size();
+        shape.triangleCount = mesh.triangleCount();
+        const u32 base = appendMeshVertices(mesh);
+        shapeTriangles.reserve(shapeTriangles.size() + mesh.triangleCount());
+        for (u32 i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            shapeTriangles.push_back(glm::uvec4(base + mesh.indices[i], base + mesh.indices[i + 1],
+                                                base + mesh.indices[i + 2], 0));
+        }
+        shapes.push_back(shape);
+        meshBVHDirty = true;
+        return (u32)shapes.size() - 1;
+    }
+
+    // Places a copy of `shape` with the object-to-world `transform`, which
+    // must be affine and invertible, and the material at `material`.
+    void addInstance(u32 shape, const glm::mat4& transform, u32 material) {
+        Instance inst;
+        inst.shape = shape;
+        inst.material = material;
+        inst.transform = transform;
+        instances.push_back(inst);
+        meshBVHDirty = true;
+    }
 
     template <typename T>
     void add(const T&, const Material&, bool aabb = false) {
         (void)aabb;
     }
 
+    // Rebuilds the hierarchy over every sphere and quad. Called by
+    // fetchBuffer() after geometry was added; CPU-only users call it directly.
+    void buildBVH() {
+        std::vector<Bounds> primBounds;
+        std::vector<i32> refs;
+        primBounds.reserve(spheres.size() + quads.size());
+        refs.reserve(spheres.size() + quads.size());
+
+        for (u32 i = 0; i < spheres.size(); ++i) {
+            const glm::vec3 r = glm::vec3(spheres[i].radius);
+            primBounds.push_back(Bounds(spheres[i].center - r, spheres[i].center + r));
+            refs.push_back((i32)(i << 1) | PRIMITIVE_SPHERE);
+        }
+
+        // Quads may be flat along an axis; pad them so every box has volume.
+        const glm::vec3 pad = glm::vec3(1e-4f);
+        for (u32 i = 0; i < quads.size(); ++i) {
+            const Quad& quad = quads[i];
+            Bounds b;
+            b.grow(quad.q);
+            b.grow(quad.q + quad.u);
+            b.grow(quad.q + quad.v);
+            b.grow(quad.q + quad.u + quad.v);
+            primBounds.push_back(Bounds(b.min - pad, b.max + pad));
+            refs.push_back((i32)(i << 1) | PRIMITIVE_QUAD);
+        }
+
+        bvh.build(primBounds);
+
+        primitiveRefs.resize(bvh.indices.size());
+        for (u32 i = 0; i < bvh.indices.size(); ++i) {
+            primitiveRefs[i] = refs[bvh.indices[i]];
+        }
+        bvhDirty = false;
+    }
+
+    // Builds the triangle hierarchy and moves the triangles into its leaf
+    // order, so leaves index them directly; then the instance levels.
+    void buildMeshBVH() {
+        std::vector<Bounds> triBounds(meshTriangles.size());
+        for (u32 i = 0; i < meshTriangles.size(); ++i) {
+            triBounds[i] = triangleBounds(meshTriangles[i]);
+        }
+
+        meshBVH.build(triBounds);
+
+        std::vector<glm::uvec4> ordered(meshTriangles.size());
+        for (u32 i = 0; i < meshBVH.indices.size(); ++i) {
+            ordered[i] = meshTriangles[meshBVH.indices[i]];
+        }
+        meshTriangles.swap(ordered);
+        std::vector<u32>().swap(meshBVH.indices);
+        buildInstances();
+        meshBVHDirty = false;
+        refreshMeshViews();
+    }
+
+    // Collects the primitives whose material emits light. Materials can be
+    // edited at runtime, so this is redone on every updateBuffer().
+    void buildLights() {
+        materialEmissive.resize(materials.size());
+        for (u32 i = 0; i < materials.size(); ++i) {
+            materialEmissive[i] = isEmissive(materials[i]);
+        }
+
+        lights.clear();
+        for (u32 i = 0; i < spheres.size(); ++i) {
+            if (isEmissive(materials[spheres[i].materialIndex])) {
+                lights.push_back((i32)(i << 1) | PRIMITIVE_SPHERE);
+            }
+        }
+        for (u32 i = 0; i < quads.size(); ++i) {
+            if (isEmissive(materials[quads[i].materialIndex])) {
+                lights.push_back((i32)(i << 1) | PRIMITIVE_QUAD);
+            }
+        }
+    }
+
+    // Builds everything derived from the scene; used directly by the CPU tracer.
+    void build() {
+        if (bvhDirty) {
+            buildBVH();
+        }
+        if (meshBVHDirty) {
+            buildMeshBVH();
+        }
+        buildLights();
+    }
+
+    // Prints the hierarchy statistics and mesh memory use.
+    void report() const {
+        bvh.report("bvh");
+        printf("primitives: %u spheres at %u bytes, %u quads at %u bytes (%s layout)\n", (u32)spheres.size(),
+                (u32)getSphereBytes(), (u32)quads.size(), (u32)getQuadBytes(), packedPrimitives ? "packed" : "std430");
+        if (!meshTriangleView.empty()) {
+            if (meshBVH.stats.primitives > 0) {
+                meshBVH.report("mesh bvh");
+            }
+            printf("mesh: %u vertices, %u triangles, %.1f MB, %.1f bytes/triangle\n",
+                    (u32)meshNormalView.size(), getMeshTriangleCount(), getMeshBytes() / (1024.0 * 1024.0),
+                    (f64)getMeshBytes() / getMeshTriangleCount());
+        }
+        if (instanceCount > 0) {
+            instanceBVH.report("instance bvh");
+            printf("instances: %u at %u bytes", instanceCount, (u32)sizeof(InstanceRecord));
+            if (!instances.empty()) {
+                printf(", %u triangles placed", getPlacedTriangleCount());
+            }
+            printf("\n");
+        }
+    }
+
     void fetchBuffer() {
-        aabbBuffer.setBuffer(aabbBoxes.data(), aabbBoxes.size() * sizeof(AABB));
+        build();
+        materialsDirty.clear();
+        spheresDirty.clear();
+        quadsDirty.clear();
+        lightBuffer.setBuffer(lights.data(), lights.size() * sizeof(i32));
+        bvhNodeBuffer.setBuffer(bvh.nodes.data(), bvh.nodes.size() * sizeof(BVHNode));
+        bvhPrimBuffer.setBuffer(primitiveRefs.data(), primitiveRefs.size() * sizeof(i32));
         materialBuffer.setBuffer(materials.data(), materials.size() * sizeof(Material));
-        sphereBuffer.setBuffer(spheres.data(), spheres.size() * sizeof(Sphere));
-        quadBuffer.setBuffer(quads.data(), quads.size() * sizeof(Quad));
+        if (packedPrimitives) {
+            packSpheres(0, (u32)spheres.size());
+            packQuads(0, (u32)quads.size());
+            primitiveMaterialBuffer.setBuffer(primitiveMaterials.data(), primitiveMaterials.size() * sizeof(i32));
+            sphereBuffer.setBuffer(packedSpheres.data(), packedSpheres.size() * sizeof(PackedSphere));
+            quadBuffer.setBuffer(packedQuads.data(), packedQuads.size() * sizeof(PackedQuad));
+        }
+        else {
+            aabbBuffer.setBuffer(aabbBoxes.data(), aabbBoxes.size() * sizeof(AABB));
+            sphereBuffer.setBuffer(spheres.data(), spheres.size() * sizeof(Sphere));
+            quadBuffer.setBuffer(quads.data(), quads.size() * sizeof(Quad));
+        }
+        meshPositionBuffer.setBuffer(meshPositionView.data(), meshPositionView.size() * sizeof(f32));
+        meshNormalBuffer.setBuffer(meshNormalView.data(), meshNormalView.size() * sizeof(u32));
+        meshTriangleBuffer.setBuffer(meshTriangleView.data(), meshTriangleView.size() * sizeof(glm::uvec4));
+        meshNodeBuffer.setBuffer(meshNodeView.data(), meshNodeView.size() * sizeof(BVHNode));
     }
 
+    // Uploads what was marked dirty since the last upload, one range per
+    // buffer. Moved primitives rebuild the hierarchy; the light list is
+    // only rebuilt when a material started or stopped emitting.
     void updateBuffer() {
-        aabbBuffer.updateBuffer(aabbBoxes.data(), aabbBoxes.size() * sizeof(AABB));
-        materialBuffer.updateBuffer(materials.data(), materials.size() * sizeof(Material));
-        sphereBuffer.updateBuffer(spheres.data(), spheres.size() * sizeof(Sphere));
-        quadBuffer.updateBuffer(quads.data(), quads.size() * sizeof(Quad));
+        bool lightsChanged = !spheresDirty.empty() || !quadsDirty.empty();
+        if (!materialsDirty.empty()) {
+            refreshMaterialFeatures();
+        }
+        // Materials added since the last buildLights() have no entry yet.
+        for (u32 i = materialsDirty.begin; i < materialsDirty.end; ++i) {
+            lightsChanged = lightsChanged || i >= materialEmissive.size() ||
+                isEmissive(materials[i]) != materialEmissive[i];
+        }
+
+        uploadRange(materialBuffer, materials, materialsDirty);
+        if (packedPrimitives) {
+            uploadPackedSpheres();
+            uploadPackedQuads();
+        }
+        else {
+            uploadRange(sphereBuffer, spheres, spheresDirty);
+            uploadRange(quadBuffer, quads, quadsDirty);
+        }
+
+        if (bvhDirty) {
+            buildBVH();
+            bvhNodeBuffer.setBuffer(bvh.nodes.data(), bvh.nodes.size() * sizeof(BVHNode));
+            bvhPrimBuffer.setBuffer(primitiveRefs.data(), primitiveRefs.size() * sizeof(i32));
+        }
+        if (lightsChanged) {
+            buildLights();
+            lightBuffer.setBuffer(lights.data(), lights.size() * sizeof(i32));
+        }
     }
 
     void bindBuffer() {
-        aabbBuffer.binding(aabbBindingIndex);
+        (packedPrimitives ? primitiveMaterialBuffer : aabbBuffer).binding(aabbBindingIndex);
         materialBuffer.binding(materialBindingIndex);
         sphereBuffer.binding(sphereBindingIndex);
         quadBuffer.binding(quadBindingIndex);
+        bvhNodeBuffer.binding(bvhNodeBindingIndex);
+        bvhPrimBuffer.binding(bvhPrimBindingIndex);
+        lightBuffer.binding(lightBindingIndex);
+        meshPositionBuffer.binding(meshPositionBindingIndex);
+        meshNormalBuffer.binding(meshNormalBindingIndex);
+        meshTriangleBuffer.binding(meshTriangleBindingIndex);
+        meshNodeBuffer.binding(meshNodeBindingIndex);
     }
 
     void unbindBuffer() {
-        aabbBuffer.bind();
+        (packedPrimitives ? primitiveMaterialBuffer : aabbBuffer).unbind();
         materialBuffer.unbind();
         sphereBuffer.unbind();
         quadBuffer.unbind();
+        bvhNodeBuffer.unbind();
+        bvhPrimBuffer.unbind();
+        lightBuffer.unbind();
+        meshPositionBuffer.unbind();
+        meshNormalBuffer.unbind();
+        meshTriangleBuffer.unbind();
+        meshNodeBuffer.unbind();
     }
 
 };
@@ -92,6 +728,9 @@ public:
 template <>
 inline void World::add<Sphere>(const Sphere& sphere, const Material& mat, bool aabb) {
     materials.push_back(mat);
+    materialFeatures |= materialFeatureBits(mat);
+    bvhDirty = true;
+    ++geometryRevision;
 
     Sphere cpy = sphere;
     cpy.materialIndex = objectCount++;
@@ -109,6 +748,9 @@ inline void World::add<Sphere>(const Sphere& sphere, const Material& mat, bool a
 template <>
 inline void World::add<Quad>(const Quad& quad, const Material& mat, bool aabb) {
     materials.push_back(mat);
+    materialFeatures |= materialFeatureBits(mat);
+    bvhDirty = true;
+    ++geometryRevision;
 
     Quad cpy = quad;
     cpy.materialIndex = objectCount++;
@@ -123,4 +765,22 @@ inline void World::add<Quad>(const Quad& quad, const Material& mat, bool aabb) {
     quads.push_back(cpy);
 }
 
+template <>
+inline void World::add<Mesh>(const Mesh& mesh, const Material& mat, bool aabb) {
+    (void)aabb;
+    materials.push_back(mat);
+    materialFeatures |= materialFeatureBits(mat);
+    meshBVHDirty = true;
+
+    const u32 materialIndex = objectCount++;
+    const u32 base = appendMeshVertices(mesh);
+
+    meshTriangles.reserve(meshTriangles.size() + mesh.triangleCount());
+    for (u32 i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        meshTriangles.push_back(glm::uvec4(base + mesh.indices[i], base + mesh.indices[i + 1],
+                                           base + mesh.indices[i + 2], materialIndex));
+    }
+    refreshMeshViews();
+}
+
 #endif
@@ -1,10 +1,121 @@
 #include "Application.h"
+#include "Scenes.h"
+#include "ImageWriter.h"
+#include "CPU/PathTracer.h"
+#include "CPU/Denoiser.h"
+#include "Options.h"
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdio>
 
 // TODO(add shader storeage buffer for complex struct):
 
-int main()
-{
-    Application app;
-    app.run();
+static int runCPU(const Options& opt) {
+    World world;
+    world.cam.pos = glm::vec3(0);
+    world.cam.forward = glm::vec3(0, 0, 1);
+    if (!loadWorld(&world, opt)) {
+        return 1;
+    }
+    world.cam.lightSampling = opt.lightSampling;
+    world.cam.roulette = opt.roulette;
+    if (opt.bounces > 0) {
+        world.cam.bounces = opt.bounces;
+    }
+    world.build();
+    world.report();
+
+    cpu::PathTracer tracer(world, opt.resolution.x, opt.resolution.y, opt.threads);
+    printf("cpu: %s %dx%d, %u threads, bounces %d, rayPerPixel %d\n", opt.scene.c_str(),
+            opt.resolution.x, opt.resolution.y, tracer.threadCount(), world.cam.bounces, world.cam.rayPerPixel);
+
+    typedef std::chrono::steady_clock Clock;
+    f64 total = 0;
+    for (u32 frameIndex = 1; frameIndex <= opt.frames; ++frameIndex) {
+        Clock::time_point st = Clock::now();
+        tracer.render(frameIndex);
+        f64 ms = std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+        total += ms;
+        printf("frame %u: %.2fms\n", frameIndex, ms);
+    }
+
+    f64 samples = (f64)tracer.samplesPerFrame() * opt.frames;
+    printf("%.0f samples in %.2fs: %.3f Msamples/s, %.2fms/frame\n",
+            samples, total / 1000.0, samples / (total * 1000.0), total / opt.frames);
+
+    const glm::vec4* pixels = tracer.getPixels().data();
+    std::vector<glm::vec4> denoised;
+    if (opt.denoise) {
+        Clock::time_point st = Clock::now();
+        cpu::denoise(DenoiseParams(), tracer.width(), tracer.height(), pixels, tracer.getAlbedo().data(),
+                tracer.getNormalDepth().data(), denoised);
+        printf("denoise: %.2fms\n", std::chrono::duration<f64, std::milli>(Clock::now() - st).count());
+        pixels = denoised.data();
+    }
+
+    if (!opt.output.empty()) {
+        if (!writeImage(opt.output, tracer.width(), tracer.height(), &pixels->x, world.gamma)) {
+            printf("failed to write '%s'\n", opt.output.c_str());
+            return 1;
+        }
+        printf("wrote %s\n", opt.output.c_str());
+    }
     return 0;
 }
+
+static int runCPUBench(const Options& opt) {
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<BenchResult> results;
+    u32 threads = 0;
+    for (u32 i = 0; i < benchCaseCount; ++i) {
+        const BenchCase& bench = benchCases[i];
+        World world;
+        if (!loadBenchCase(&world, bench)) {
+            printf("unknown scene '%s'\n", bench.scene);
+            return 1;
+        }
+        world.build();
+
+        cpu::PathTracer tracer(world, bench.resolution.x, bench.resolution.y, opt.threads);
+        threads = tracer.threadCount();
+
+        // Matches the GPU run, which spends its first frame on warm-up.
+        tracer.render(1);
+        tracer.resetRayCount();
+
+        BenchResult result;
+        result.bench = bench;
+        for (u32 frame = 0; frame < bench.frames; ++frame) {
+            Clock::time_point st = Clock::now();
+            tracer.render(frame + 2);
+            result.totalMs += std::chrono::duration<f64, std::milli>(Clock::now() - st).count();
+        }
+        result.samples = tracer.samplesPerFrame() * bench.frames;
+        result.rays = tracer.raysTraced();
+        results.push_back(result);
+    }
+
+    const std::string device = std::to_string(threads) + " threads";
+    if (!writeBenchReport(opt.output, "cpu", device, results)) {
+        printf("failed to write '%s'\n", opt.output.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (opt.cpu) {
+        return opt.bench ? runCPUBench(opt) : runCPU(opt);
+    }
+
+    Application app(opt);
+    return app.run();
+}